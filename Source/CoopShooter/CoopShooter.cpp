@@ -2,5 +2,23 @@
 
 #include "CoopShooter.h"
 #include "Modules/ModuleManager.h"
+#include "Engine/ReplicationDriver.h"
+#include "Net/SReplicationGraph.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, CoopShooter, "CoopShooter" );
+class FCoopShooterModule : public FDefaultGameModuleImpl
+{
+public:
+
+	virtual void StartupModule() override
+	{
+		// Game net drivers use our replication graph, see COOP.RepGraph
+		UReplicationDriver::CreateReplicationDriverDelegate().BindStatic(&USReplicationGraph::CreateReplicationDriver);
+	}
+
+	virtual void ShutdownModule() override
+	{
+		UReplicationDriver::CreateReplicationDriverDelegate().Unbind();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FCoopShooterModule, CoopShooter, "CoopShooter" );
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/SBotController.h"
+#include "SCharacter.h"
+#include "TimerManager.h"
+
+ASBotController::ASBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	MinActionTime = 2.0f;
+	MaxActionTime = 5.0f;
+	CrouchChance = 0.25f;
+	ADSChance = 0.5f;
+
+	BotCharacter = nullptr;
+	WanderDirection = FVector::ForwardVector;
+	AimPitch = 0.0f;
+}
+
+void ASBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	BotCharacter = Cast<ASCharacter>(InPawn);
+	if (!BotCharacter)
+		return;
+
+	SetActorTickEnabled(true);
+	ChangeAction();
+}
+
+void ASBotController::OnUnPossess()
+{
+	if (BotCharacter)
+	{
+		BotCharacter->EndFire();
+		BotCharacter = nullptr;
+	}
+
+	SetActorTickEnabled(false);
+	GetWorldTimerManager().ClearTimer(TimerHandle_ChangeAction);
+
+	Super::OnUnPossess();
+}
+
+void ASBotController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!BotCharacter)
+		return;
+
+	// Walk into walls and all, the load only needs the movement and the shots to be real
+	BotCharacter->AddMovementInput(WanderDirection);
+
+	FRotator AimRotation = WanderDirection.Rotation();
+	AimRotation.Pitch = AimPitch;
+	SetControlRotation(AimRotation);
+}
+
+void ASBotController::ChangeAction()
+{
+	if (!BotCharacter)
+		return;
+
+	WanderDirection = FRotator(0.0f, FMath::FRandRange(-180.0f, 180.0f), 0.0f).Vector();
+	AimPitch = FMath::FRandRange(-10.0f, 10.0f);
+
+	if (FMath::FRand() < CrouchChance)
+	{
+		BotCharacter->BeginCrouch();
+	}
+	else
+	{
+		BotCharacter->EndCrouch();
+	}
+
+	if (FMath::FRand() < ADSChance)
+	{
+		BotCharacter->BeginADS();
+	}
+	else
+	{
+		BotCharacter->EndADS();
+	}
+
+	// Release and press the trigger again so StartFire and EndFire are exercised as well as the fire timer
+	BotCharacter->EndFire();
+	BotCharacter->StartFire();
+
+	GetWorldTimerManager().SetTimer(TimerHandle_ChangeAction, this, &ASBotController::ChangeAction, FMath::FRandRange(MinActionTime, MaxActionTime), false);
+}
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/SCameraSwayComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Camera/CameraShake.h"
+
+// Sets default values for this component's properties
+USCameraSwayComponent::USCameraSwayComponent()
+{
+	// Only ticks on the locally controlled pawn
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// defaults
+	IdleSpeedThreshold = 10.0f;
+	State = ECameraSwayState::None;
+	CurrentShake = nullptr;
+}
+
+void USCameraSwayComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopCurrentShake();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void USCameraSwayComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	ECameraSwayState DesiredState = GetDesiredState();
+
+	if (DesiredState != State)
+	{
+		EnterState(DesiredState);
+	}
+	else if (CurrentShake && CurrentShake->IsFinished())
+	{
+		// Keep the sway going for as long as we stay in the state
+		EnterState(State);
+	}
+}
+
+void USCameraSwayComponent::SetCameraShakes(TSubclassOf<UCameraShake> InIdleShake, TSubclassOf<UCameraShake> InForwardShake, TSubclassOf<UCameraShake> InRightShake)
+{
+	IdleShake = InIdleShake;
+	ForwardShake = InForwardShake;
+	RightShake = InRightShake;
+}
+
+void USCameraSwayComponent::SetSwayEnabled(bool bEnabled)
+{
+	SetComponentTickEnabled(bEnabled);
+
+	if (!bEnabled)
+	{
+		StopCurrentShake();
+		State = ECameraSwayState::None;
+	}
+}
+
+ECameraSwayState USCameraSwayComponent::GetDesiredState() const
+{
+	AActor* MyOwner = GetOwner();
+	if (!MyOwner)
+		return ECameraSwayState::None;
+
+	FVector Velocity = MyOwner->GetVelocity();
+	Velocity.Z = 0.0f;
+
+	if (Velocity.SizeSquared() < FMath::Square(IdleSpeedThreshold))
+		return ECameraSwayState::Idle;
+
+	float ForwardSpeed = FMath::Abs(FVector::DotProduct(Velocity, MyOwner->GetActorForwardVector()));
+	float RightSpeed = FMath::Abs(FVector::DotProduct(Velocity, MyOwner->GetActorRightVector()));
+
+	return ForwardSpeed >= RightSpeed ? ECameraSwayState::MovingForward : ECameraSwayState::MovingRight;
+}
+
+void USCameraSwayComponent::EnterState(ECameraSwayState NewState)
+{
+	StopCurrentShake();
+	State = NewState;
+
+	TSubclassOf<UCameraShake> Shake = GetShakeForState(NewState);
+	APlayerController* PC = GetLocalPlayerController();
+
+	if (Shake && PC && PC->PlayerCameraManager)
+	{
+		CurrentShake = PC->PlayerCameraManager->PlayCameraShake(Shake, 1.0f);
+		CurrentCameraManager = PC->PlayerCameraManager;
+	}
+}
+
+void USCameraSwayComponent::StopCurrentShake()
+{
+	if (CurrentShake && CurrentCameraManager.IsValid())
+	{
+		CurrentCameraManager->StopCameraShake(CurrentShake, false);
+	}
+
+	CurrentShake = nullptr;
+	CurrentCameraManager.Reset();
+}
+
+TSubclassOf<UCameraShake> USCameraSwayComponent::GetShakeForState(ECameraSwayState InState) const
+{
+	switch (InState)
+	{
+	case ECameraSwayState::Idle:
+		return IdleShake;
+	case ECameraSwayState::MovingForward:
+		return ForwardShake;
+	case ECameraSwayState::MovingRight:
+		return RightShake;
+	default:
+		return nullptr;
+	}
+}
+
+APlayerController* USCameraSwayComponent::GetLocalPlayerController() const
+{
+	APawn* MyPawn = Cast<APawn>(GetOwner());
+	APlayerController* PC = MyPawn ? Cast<APlayerController>(MyPawn->GetController()) : nullptr;
+
+	return PC && PC->IsLocalController() ? PC : nullptr;
+}
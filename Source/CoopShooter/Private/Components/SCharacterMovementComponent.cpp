@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/SCharacterMovementComponent.h"
+#include "GameFramework/Character.h"
+
+// Sets default values for this component's properties
+USCharacterMovementComponent::USCharacterMovementComponent()
+{
+	// defaults
+	AimSpeedMultiplier = 0.6f;
+	SprintSpeedMultiplier = 1.5f;
+
+	bWantsToAim = false;
+	bWantsToSprint = false;
+}
+
+float USCharacterMovementComponent::GetMaxSpeed() const
+{
+	float MaxSpeed = Super::GetMaxSpeed();
+
+	// Crouching already has its own speed
+	if (!IsMovingOnGround() || IsCrouching())
+		return MaxSpeed;
+
+	if (bWantsToAim)
+		return MaxSpeed * AimSpeedMultiplier;
+
+	if (bWantsToSprint)
+		return MaxSpeed * SprintSpeedMultiplier;
+
+	return MaxSpeed;
+}
+
+void USCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToAim = (Flags & FSSavedMove_Character::FLAG_Aiming) != 0;
+	bWantsToSprint = (Flags & FSSavedMove_Character::FLAG_Sprinting) != 0;
+}
+
+bool USCharacterMovementComponent::ClientUpdatePositionAfterServerUpdate()
+{
+	// Replaying the saved moves applies the flags they were made with, keep what the input wants now
+	const bool bRealWantsToAim = bWantsToAim;
+	const bool bRealWantsToSprint = bWantsToSprint;
+
+	bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
+
+	bWantsToAim = bRealWantsToAim;
+	bWantsToSprint = bRealWantsToSprint;
+
+	return bResult;
+}
+
+FNetworkPredictionData_Client* USCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		USCharacterMovementComponent* MutableThis = const_cast<USCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FSNetworkPredictionData_Client_Character(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void FSSavedMove_Character::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToAim = false;
+	bSavedWantsToSprint = false;
+}
+
+uint8 FSSavedMove_Character::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+
+	if (bSavedWantsToAim)
+	{
+		Result |= FLAG_Aiming;
+	}
+
+	if (bSavedWantsToSprint)
+	{
+		Result |= FLAG_Sprinting;
+	}
+
+	return Result;
+}
+
+bool FSSavedMove_Character::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSSavedMove_Character* NewSMove = static_cast<const FSSavedMove_Character*>(NewMove.Get());
+
+	// A move that changes speed has to reach the server on its own
+	if (bSavedWantsToAim != NewSMove->bSavedWantsToAim || bSavedWantsToSprint != NewSMove->bSavedWantsToSprint)
+		return false;
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSSavedMove_Character::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	USCharacterMovementComponent* MovementComponent = Cast<USCharacterMovementComponent>(Character->GetCharacterMovement());
+	if (MovementComponent)
+	{
+		bSavedWantsToAim = MovementComponent->bWantsToAim;
+		bSavedWantsToSprint = MovementComponent->bWantsToSprint;
+	}
+}
+
+FSNetworkPredictionData_Client_Character::FSNetworkPredictionData_Client_Character(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FSNetworkPredictionData_Client_Character::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSSavedMove_Character());
+}
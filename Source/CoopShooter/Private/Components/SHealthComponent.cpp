@@ -4,6 +4,9 @@
 #include "SHealthComponent.h"
 #include "..\..\Public\Components\SHealthComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "Rules/SGameplayRules.h"
 
 
 // Sets default values for this component's properties
@@ -11,6 +14,11 @@ USHealthComponent::USHealthComponent()
 {
 	// defaults
 	DefaultHealth = 100;
+	RegenDelay = 5.0f;
+	RegenRate = 20.0f;
+
+	// Clients see full health until the servers state arrives
+	HealthState.BaseHealth = DefaultHealth;
 
 	SetIsReplicated(true);
 }
@@ -28,40 +36,108 @@ void USHealthComponent::BeginPlay()
 	{
 		AActor* MyOwner = GetOwner();
 
+		// Weapon hits come from the damage queue, this catches everything else
 		if (MyOwner)
 		{
 			MyOwner->OnTakeAnyDamage.AddDynamic(this, &USHealthComponent::HandleTakeAnyDamage);
 		}
+
+		// Clients keep the replicated state, by now it may already hold damage
+		HealthState.BaseHealth = DefaultHealth;
+		HealthState.RegenStartServerTime = 0.0f;
+		HealthState.RegenRate = RegenRate;
 	}
-	
-	Health = DefaultHealth;
+}
+
+float USHealthComponent::GetServerWorldTimeSeconds() const
+{
+	UWorld* World = GetWorld();
+	if (!World)
+		return 0.0f;
+
+	AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+float USHealthComponent::GetHealthAt(const FSHealthState& State, float ServerTime) const
+{
+	return SGameplayRules::GetRegeneratedHealth(State.BaseHealth, State.RegenStartServerTime, State.RegenRate, DefaultHealth, ServerTime);
+}
+
+float USHealthComponent::GetHealth() const
+{
+	return GetHealthAt(HealthState, GetServerWorldTimeSeconds());
+}
+
+bool USHealthComponent::IsRegenerating() const
+{
+	if (HealthState.RegenRate <= 0.0f || HealthState.BaseHealth <= 0.0f)
+		return false;
+
+	return GetHealth() < DefaultHealth;
 }
 
 void USHealthComponent::HandleTakeAnyDamage(AActor * DamagedActor, float Damage, const UDamageType * DamageType, AController * InstigatedBy, AActor * DamageCauser)
+{
+	ApplyDamage(Damage, DamageType, InstigatedBy, DamageCauser);
+}
+
+void USHealthComponent::ApplyDamage(float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser)
 {
 	if (Damage <= 0.0f)
 		return;
 
-	// Update health clamped
-	Health = FMath::Clamp(Health - Damage, 0.0f, DefaultHealth);
+	const float Now = GetServerWorldTimeSeconds();
+
+	// Whatever regenerated so far becomes the new base, regeneration starts over after the delay
+	const float Health = SGameplayRules::ApplyDamage(GetHealthAt(HealthState, Now), Damage, DefaultHealth);
 
-	OnHealthChanged.Broadcast(this, Health, Damage, DamageType, InstigatedBy, DamageCauser);
+	HealthState.BaseHealth = Health;
+	HealthState.RegenStartServerTime = Now + RegenDelay;
+	HealthState.RegenRate = Health > 0.0f ? RegenRate : 0.0f;
+
+	BroadcastHealthChanged(Health, Damage, DamageType, InstigatedBy, DamageCauser);
 }
 
-void USHealthComponent::GiveHealth(float _Health)
+void USHealthComponent::BroadcastHealthChanged(float Health, float HealthDelta, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser)
 {
+	OnHealthChangedNative.Broadcast(this, Health, HealthDelta, DamageType, InstigatedBy, DamageCauser);
+	OnHealthChanged.Broadcast(this, Health, HealthDelta, DamageType, InstigatedBy, DamageCauser);
+}
 
-	if (Health += _Health >= DefaultHealth)
-		Health = DefaultHealth;
-	else
-		Health = +_Health;
+void USHealthComponent::OnRep_HealthState(const FSHealthState& OldHealthState)
+{
+	const float Now = GetServerWorldTimeSeconds();
+	const float Health = GetHealthAt(HealthState, Now);
 
-	UE_LOG(LogTemp, Warning, TEXT("%f"), Health);
+	// The damage details are not replicated, only how much health was lost
+	BroadcastHealthChanged(Health, GetHealthAt(OldHealthState, Now) - Health, nullptr, nullptr, nullptr);
+}
+
+void USHealthComponent::GiveHealth(float Amount)
+{
+	if (Amount <= 0.0f || GetOwnerRole() != ROLE_Authority)
+		return;
+
+	const float Now = GetServerWorldTimeSeconds();
+	const float OldHealth = GetHealthAt(HealthState, Now);
+
+	// Dead stays dead
+	if (OldHealth <= 0.0f)
+		return;
+
+	const float Health = SGameplayRules::GiveHealth(OldHealth, Amount, DefaultHealth);
+
+	// Keep a pending regeneration delay, otherwise carry on regenerating from the new base
+	HealthState.BaseHealth = Health;
+	HealthState.RegenStartServerTime = FMath::Max(HealthState.RegenStartServerTime, Now);
+
+	BroadcastHealthChanged(Health, OldHealth - Health, nullptr, nullptr, nullptr);
 }
 
 void USHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(USHealthComponent, Health);
-}
\ No newline at end of file
+	DOREPLIFETIME(USHealthComponent, HealthState);
+}
@@ -0,0 +1,309 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/SInventoryComponent.h"
+#include "Subsystems/SWeaponPoolSubsystem.h"
+#include "Subsystems/SAssetStreamingSubsystem.h"
+#include "Net/SReplicationGraph.h"
+#include "Net/SNetStats.h"
+#include "SCharacter.h"
+#include "SWeapon.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+
+void FSInventoryItem::PreReplicatedRemove(const FSInventoryList& InArraySerializer)
+{
+	// About to go, make sure the holster does not keep showing it
+	WeaponClass = nullptr;
+
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->UpdateHolsterProxy();
+	}
+}
+
+void FSInventoryItem::PostReplicatedAdd(const FSInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->UpdateHolsterProxy();
+	}
+}
+
+void FSInventoryItem::PostReplicatedChange(const FSInventoryList& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->UpdateHolsterProxy();
+	}
+}
+
+const FSInventoryItem* FSInventoryList::FindItem(uint8 Slot) const
+{
+	return Items.FindByPredicate([Slot](const FSInventoryItem& Item) { return Item.Slot == Slot; });
+}
+
+bool FSInventoryList::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+
+	bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FSInventoryItem, FSInventoryList>(Items, DeltaParms, *this);
+
+	if (DeltaParms.Writer)
+	{
+		FSNetStats::RecordProperty(TEXT("SInventoryComponent"), TEXT("Inventory"), DeltaParms.Writer->GetNumBits() - StartBits);
+	}
+
+	return bResult;
+}
+
+// Sets default values for this component's properties
+USInventoryComponent::USInventoryComponent()
+{
+	// defaults
+	EquippedSocketName = "weapon_socket";
+	HolsterSocketName = "weapon_rifle_holster";
+
+	EquippedWeapon = nullptr;
+	EquippedSlot = 0;
+	NextFreeSlot = 1;
+	HolsterProxy = nullptr;
+
+	SetIsReplicated(true);
+}
+
+// Called when the game starts
+void USInventoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Inventory.OwnerComponent = this;
+}
+
+void USInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The equipped weapon is kept for whoever needs one next
+	if (GetOwnerRole() == ROLE_Authority && EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		ReleaseEquippedWeapon();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 USInventoryComponent::AddWeapon(TSubclassOf<ASWeapon> WeaponClass)
+{
+	if (!WeaponClass || GetOwnerRole() != ROLE_Authority)
+		return INDEX_NONE;
+
+	// Zero means nothing is equipped, skip it and any slot still in use when wrapping around
+	while (NextFreeSlot == 0 || Inventory.FindItem(NextFreeSlot))
+	{
+		NextFreeSlot++;
+	}
+
+	FSInventoryItem& Item = Inventory.Items.AddDefaulted_GetRef();
+	Item.WeaponClass = WeaponClass;
+	Item.Slot = NextFreeSlot++;
+	Inventory.MarkItemDirty(Item);
+
+	UpdateHolsterProxy();
+
+	return Item.Slot;
+}
+
+void USInventoryComponent::EquipWeapon(uint8 Slot)
+{
+	if (GetOwnerRole() != ROLE_Authority)
+		return;
+
+	const FSInventoryItem* Item = Inventory.FindItem(Slot);
+	if (!Item || (EquippedWeapon && EquippedSlot == Slot))
+		return;
+
+	USWeaponPoolSubsystem* WeaponPool = GetWorld()->GetSubsystem<USWeaponPoolSubsystem>();
+	if (!WeaponPool)
+		return;
+
+	ReleaseEquippedWeapon();
+
+	EquippedWeapon = WeaponPool->AcquireWeapon(Item->WeaponClass, GetOwner());
+	EquippedSlot = EquippedWeapon ? Slot : 0;
+
+	if (EquippedWeapon)
+	{
+		ACharacter* Character = Cast<ACharacter>(GetOwner());
+		if (Character)
+		{
+			EquippedWeapon->AttachToComponent(Character->GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, EquippedSocketName);
+		}
+
+		// Weapons replicate alongside their character rather than being checked for relevancy on their own
+		if (USReplicationGraph* ReplicationGraph = USReplicationGraph::Get(GetWorld()))
+		{
+			ReplicationGraph->OnCharacterWeaponChanged(Cast<ASCharacter>(GetOwner()), EquippedWeapon, nullptr);
+		}
+	}
+
+	UpdateHolsterProxy();
+}
+
+void USInventoryComponent::EquipNextWeapon()
+{
+	if (GetOwnerRole() < ROLE_Authority)
+	{
+		ServerEquipNextWeapon();
+		return;
+	}
+
+	int32 NextSlot = GetNextSlot();
+	if (NextSlot != INDEX_NONE)
+	{
+		EquipWeapon(NextSlot);
+	}
+}
+
+void USInventoryComponent::ServerEquipNextWeapon_Implementation()
+{
+	EquipNextWeapon();
+}
+
+bool USInventoryComponent::ServerEquipNextWeapon_Validate()
+{
+	return true;
+}
+
+void USInventoryComponent::RemoveEquippedWeapon()
+{
+	if (GetOwnerRole() != ROLE_Authority || !EquippedWeapon)
+		return;
+
+	const uint8 Slot = EquippedSlot;
+
+	ReleaseEquippedWeapon();
+
+	int32 Index = Inventory.Items.IndexOfByPredicate([Slot](const FSInventoryItem& Item) { return Item.Slot == Slot; });
+	if (Index != INDEX_NONE)
+	{
+		Inventory.Items.RemoveAtSwap(Index);
+		Inventory.MarkArrayDirty();
+	}
+
+	UpdateHolsterProxy();
+}
+
+void USInventoryComponent::ReleaseEquippedWeapon()
+{
+	if (!EquippedWeapon)
+		return;
+
+	USWeaponPoolSubsystem* WeaponPool = GetWorld()->GetSubsystem<USWeaponPoolSubsystem>();
+	if (WeaponPool)
+	{
+		WeaponPool->ReleaseWeapon(EquippedWeapon);
+	}
+	else
+	{
+		EquippedWeapon->Destroy();
+	}
+
+	// Released first, so the weapon is already hidden and detached when the graph closes its channels
+	if (USReplicationGraph* ReplicationGraph = USReplicationGraph::Get(GetWorld()))
+	{
+		ReplicationGraph->OnCharacterWeaponChanged(Cast<ASCharacter>(GetOwner()), nullptr, EquippedWeapon);
+	}
+
+	EquippedWeapon = nullptr;
+	EquippedSlot = 0;
+}
+
+bool USInventoryComponent::HasWeapon(TSubclassOf<ASWeapon> WeaponClass) const
+{
+	return Inventory.Items.ContainsByPredicate([&WeaponClass](const FSInventoryItem& Item) { return Item.WeaponClass == WeaponClass; });
+}
+
+int32 USInventoryComponent::GetNextSlot() const
+{
+	int32 NextSlot = INDEX_NONE;
+	int32 FirstSlot = INDEX_NONE;
+
+	for (const FSInventoryItem& Item : Inventory.Items)
+	{
+		if (!Item.WeaponClass || Item.Slot == EquippedSlot)
+			continue;
+
+		if (FirstSlot == INDEX_NONE || Item.Slot < FirstSlot)
+		{
+			FirstSlot = Item.Slot;
+		}
+
+		if (Item.Slot > EquippedSlot && (NextSlot == INDEX_NONE || Item.Slot < NextSlot))
+		{
+			NextSlot = Item.Slot;
+		}
+	}
+
+	return NextSlot != INDEX_NONE ? NextSlot : FirstSlot;
+}
+
+void USInventoryComponent::OnRep_EquippedSlot()
+{
+	UpdateHolsterProxy();
+}
+
+void USInventoryComponent::UpdateHolsterProxy()
+{
+	if (GetNetMode() == NM_DedicatedServer)
+		return;
+
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (!Character)
+		return;
+
+	const int32 NextSlot = GetNextSlot();
+	const FSInventoryItem* Item = NextSlot != INDEX_NONE ? Inventory.FindItem(NextSlot) : nullptr;
+	const ASWeapon* WeaponCDO = Item && Item->WeaponClass ? Item->WeaponClass->GetDefaultObject<ASWeapon>() : nullptr;
+
+	UStaticMesh* Mesh = WeaponCDO ? WeaponCDO->HolsterMesh.Get() : nullptr;
+
+	// Stream the mesh in and come back once it is. Each mesh is only asked for once, one that is still missing after
+	// its load has finished failed to load and is not shown
+	if (WeaponCDO && !Mesh && !WeaponCDO->HolsterMesh.IsNull())
+	{
+		const FSoftObjectPath MeshPath = WeaponCDO->HolsterMesh.ToSoftObjectPath();
+		USAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<USAssetStreamingSubsystem>();
+
+		if (Streaming && !RequestedHolsterMeshes.Contains(MeshPath))
+		{
+			RequestedHolsterMeshes.Add(MeshPath);
+			Streaming->RequestLoad({ MeshPath }, true, FStreamableDelegate::CreateUObject(this, &USInventoryComponent::UpdateHolsterProxy));
+		}
+	}
+
+	if (!HolsterProxy)
+	{
+		if (!Mesh)
+			return;
+
+		HolsterProxy = NewObject<UStaticMeshComponent>(Character, TEXT("HolsterProxy"));
+		HolsterProxy->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		HolsterProxy->SetGenerateOverlapEvents(false);
+		HolsterProxy->SetupAttachment(Character->GetMesh(), HolsterSocketName);
+		HolsterProxy->RegisterComponent();
+	}
+
+	HolsterProxy->SetStaticMesh(Mesh);
+	HolsterProxy->SetVisibility(Mesh != nullptr);
+}
+
+void USInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(USInventoryComponent, Inventory);
+	DOREPLIFETIME(USInventoryComponent, EquippedWeapon);
+	DOREPLIFETIME(USInventoryComponent, EquippedSlot);
+}
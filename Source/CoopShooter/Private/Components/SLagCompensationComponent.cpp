@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/SLagCompensationComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Subsystems/SLagCompensationSubsystem.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "CoopShooter.h"
+
+// Debug commands
+static int32 DebugLagCompensationDrawing = 0;
+FAutoConsoleVariableRef CVARDebugLagCompensationDrawing(
+	TEXT("COOP.DebugLagCompensation"),
+	DebugLagCompensationDrawing,
+	TEXT("Draw the rewound hitboxes every time a shot is traced against them"),
+	ECVF_Cheat);
+
+// Sets default values for this component's properties
+USLagCompensationComponent::USLagCompensationComponent()
+{
+	// Record once the pose has been updated for the frame
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	// defaults, these match the bones of the mannequin skeleton
+	Hitboxes.Add(FSHitboxDefinition("head", NAME_None, 14.0f, SURFACE_FLESHVULNERABLE));
+	Hitboxes.Add(FSHitboxDefinition("pelvis", "spine_02", 18.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("spine_02", "neck_01", 20.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("upperarm_l", "lowerarm_l", 7.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("lowerarm_l", "hand_l", 6.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("upperarm_r", "lowerarm_r", 7.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("lowerarm_r", "hand_r", 6.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("thigh_l", "calf_l", 10.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("calf_l", "foot_l", 8.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("thigh_r", "calf_r", 10.0f, SURFACE_FLESHDEFAULT));
+	Hitboxes.Add(FSHitboxDefinition("calf_r", "foot_r", 8.0f, SURFACE_FLESHDEFAULT));
+
+	HistoryHead = 0;
+	HistoryCount = 0;
+	NumHitboxes = 0;
+	MeshComponent = nullptr;
+}
+
+
+// Called when the game starts
+void USLagCompensationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AActor* MyOwner = GetOwner();
+	MeshComponent = MyOwner ? MyOwner->FindComponentByClass<USkeletalMeshComponent>() : nullptr;
+
+	// Nothing to record hitboxes from
+	if (!MeshComponent)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	// The server rewinds the history and clients trace their predicted hits against the newest frame, both through
+	// the broadphase. Neither may see the mesh, a dedicated server never renders it and a client may have it off
+	// screen, so make sure the bones are still updated or the frames would be stale
+	MeshComponent->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+
+	NumHitboxes = 0;
+	for (const FSHitboxDefinition& Hitbox : Hitboxes)
+	{
+		if (NumHitboxes == FSHitboxFrame::MaxHitboxes)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s has more than %d hitboxes, the rest are ignored"), *GetNameSafe(MyOwner), FSHitboxFrame::MaxHitboxes);
+			break;
+		}
+
+		const int32 StartBoneIndex = MeshComponent->GetBoneIndex(Hitbox.BoneName);
+		if (StartBoneIndex == INDEX_NONE)
+			continue;
+
+		StartBoneIndices[NumHitboxes] = StartBoneIndex;
+		EndBoneIndices[NumHitboxes] = Hitbox.EndBoneName.IsNone() ? INDEX_NONE : MeshComponent->GetBoneIndex(Hitbox.EndBoneName);
+		Radii[NumHitboxes] = Hitbox.Radius;
+		SurfaceTypes[NumHitboxes] = Hitbox.SurfaceType;
+		NumHitboxes++;
+	}
+
+	if (USLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<USLagCompensationSubsystem>())
+	{
+		LagCompensation->RegisterComponent(this);
+	}
+}
+
+void USLagCompensationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<USLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterComponent(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void USLagCompensationComponent::StopRecording()
+{
+	SetComponentTickEnabled(false);
+	HistoryCount = 0;
+
+	if (USLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<USLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterComponent(this);
+	}
+}
+
+bool USLagCompensationComponent::IsRagdolled() const
+{
+	return MeshComponent && MeshComponent->IsSimulatingPhysics();
+}
+
+void USLagCompensationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	RecordFrame(GetWorld()->GetTimeSeconds());
+}
+
+void USLagCompensationComponent::RecordFrame(float Time)
+{
+	if (NumHitboxes == 0)
+		return;
+
+	FSHitboxFrame& Frame = History[HistoryHead];
+	Frame.Time = Time;
+
+	FBox Bounds(ForceInit);
+	float MaxRadius = 0.0f;
+
+	for (int32 i = 0; i < NumHitboxes; i++)
+	{
+		Frame.Start[i] = MeshComponent->GetBoneTransform(StartBoneIndices[i]).GetLocation();
+		Frame.End[i] = EndBoneIndices[i] != INDEX_NONE ? MeshComponent->GetBoneTransform(EndBoneIndices[i]).GetLocation() : Frame.Start[i];
+
+		Bounds += Frame.Start[i];
+		Bounds += Frame.End[i];
+		MaxRadius = FMath::Max(MaxRadius, Radii[i]);
+	}
+
+	Frame.BoundsCenter = Bounds.GetCenter();
+	Frame.BoundsRadius = Bounds.GetExtent().Size() + MaxRadius;
+
+	HistoryHead = (HistoryHead + 1) % MaxHistoryFrames;
+	HistoryCount = FMath::Min(HistoryCount + 1, MaxHistoryFrames);
+}
+
+bool USLagCompensationComponent::GetRewoundFrame(float Time, FSHitboxFrame& OutFrame) const
+{
+	if (HistoryCount == 0)
+		return false;
+
+	const int32 Newest = (HistoryHead - 1 + MaxHistoryFrames) % MaxHistoryFrames;
+
+	if (Time >= History[Newest].Time)
+	{
+		OutFrame = History[Newest];
+		return true;
+	}
+
+	// Walk back from the newest frame until we find the one just before Time
+	for (int32 i = 1; i < HistoryCount; i++)
+	{
+		const FSHitboxFrame& Older = History[(Newest - i + MaxHistoryFrames) % MaxHistoryFrames];
+
+		if (Older.Time <= Time)
+		{
+			const FSHitboxFrame& Newer = History[(Newest - i + 1 + MaxHistoryFrames) % MaxHistoryFrames];
+			const float Alpha = (Time - Older.Time) / FMath::Max(Newer.Time - Older.Time, KINDA_SMALL_NUMBER);
+
+			OutFrame.Time = Time;
+			OutFrame.BoundsCenter = FMath::Lerp(Older.BoundsCenter, Newer.BoundsCenter, Alpha);
+			OutFrame.BoundsRadius = FMath::Max(Older.BoundsRadius, Newer.BoundsRadius);
+
+			for (int32 j = 0; j < NumHitboxes; j++)
+			{
+				OutFrame.Start[j] = FMath::Lerp(Older.Start[j], Newer.Start[j], Alpha);
+				OutFrame.End[j] = FMath::Lerp(Older.End[j], Newer.End[j], Alpha);
+			}
+
+			return true;
+		}
+	}
+
+	// Older than anything we have, use the oldest frame
+	OutFrame = History[(Newest - (HistoryCount - 1) + MaxHistoryFrames) % MaxHistoryFrames];
+	return true;
+}
+
+bool USLagCompensationComponent::TraceRewound(const FVector& TraceStart, const FVector& TraceEnd, float Time, FHitResult& OutHit, EPhysicalSurface& OutSurfaceType) const
+{
+	FSHitboxFrame Frame;
+	if (!GetRewoundFrame(Time, Frame))
+		return false;
+
+	if (FMath::PointDistToSegment(Frame.BoundsCenter, TraceStart, TraceEnd) > Frame.BoundsRadius)
+		return false;
+
+	int32 BestIndex = INDEX_NONE;
+	float BestDistance = MAX_FLT;
+	FVector BestImpact = FVector::ZeroVector;
+	FVector BestNormal = FVector::ZeroVector;
+
+	const bool bHit = TraceCapsules(TraceStart, TraceEnd, Frame.Start, Frame.End, Radii, NumHitboxes, BestIndex, BestDistance, BestImpact, BestNormal);
+
+	if (DebugLagCompensationDrawing > 0)
+	{
+		DrawRewoundFrame(Frame, bHit ? FColor::Red : FColor::Green);
+	}
+
+	if (!bHit)
+		return false;
+
+	OutHit = MakeHitResult(BestIndex, TraceStart, TraceEnd, BestImpact, BestNormal, BestDistance);
+	OutSurfaceType = SurfaceTypes[BestIndex];
+
+	return true;
+}
+
+bool USLagCompensationComponent::TraceCapsules(const FVector& TraceStart, const FVector& TraceEnd, const FVector* Starts, const FVector* Ends, const float* CapsuleRadii, int32 NumCapsules,
+	int32& OutIndex, float& OutDistance, FVector& OutImpact, FVector& OutNormal)
+{
+	const FVector TraceDirection = (TraceEnd - TraceStart).GetSafeNormal();
+
+	OutIndex = INDEX_NONE;
+	OutDistance = MAX_FLT;
+
+	for (int32 i = 0; i < NumCapsules; i++)
+	{
+		FVector OnTrace, OnHitbox;
+		FMath::SegmentDistToSegmentSafe(TraceStart, TraceEnd, Starts[i], Ends[i], OnTrace, OnHitbox);
+
+		const float DistanceSq = FVector::DistSquared(OnTrace, OnHitbox);
+		const float RadiusSq = FMath::Square(CapsuleRadii[i]);
+
+		if (DistanceSq > RadiusSq)
+			continue;
+
+		// Step back along the trace to where it entered the capsule
+		const FVector Impact = OnTrace - TraceDirection * FMath::Sqrt(RadiusSq - DistanceSq);
+		const float Distance = FMath::Max(FVector::DotProduct(Impact - TraceStart, TraceDirection), 0.0f);
+
+		if (Distance < OutDistance)
+		{
+			OutIndex = i;
+			OutDistance = Distance;
+			OutImpact = Impact;
+			OutNormal = (Impact - OnHitbox).GetSafeNormal();
+		}
+	}
+
+	return OutIndex != INDEX_NONE;
+}
+
+FHitResult USLagCompensationComponent::MakeHitResult(int32 HitboxIndex, const FVector& TraceStart, const FVector& TraceEnd, const FVector& Impact, const FVector& Normal, float Distance) const
+{
+	FHitResult Hit(GetOwner(), MeshComponent, Impact, Normal);
+	Hit.bBlockingHit = true;
+	Hit.TraceStart = TraceStart;
+	Hit.TraceEnd = TraceEnd;
+	Hit.Distance = Distance;
+	Hit.Time = Distance / FMath::Max(FVector::Dist(TraceStart, TraceEnd), KINDA_SMALL_NUMBER);
+	Hit.BoneName = MeshComponent->GetBoneName(StartBoneIndices[HitboxIndex]);
+
+	return Hit;
+}
+
+const FSHitboxFrame* USLagCompensationComponent::GetNewestFrame() const
+{
+	if (HistoryCount == 0)
+		return nullptr;
+
+	return &History[(HistoryHead - 1 + MaxHistoryFrames) % MaxHistoryFrames];
+}
+
+float USLagCompensationComponent::GetOldestRecordedTime() const
+{
+	if (HistoryCount == 0)
+		return -1.0f;
+
+	return History[(HistoryHead - HistoryCount + MaxHistoryFrames) % MaxHistoryFrames].Time;
+}
+
+void USLagCompensationComponent::DrawRewoundFrame(const FSHitboxFrame& Frame, const FColor& Color) const
+{
+	for (int32 i = 0; i < NumHitboxes; i++)
+	{
+		const FVector Axis = Frame.End[i] - Frame.Start[i];
+		const FQuat Rotation = Axis.IsNearlyZero() ? FQuat::Identity : FRotationMatrix::MakeFromZ(Axis).ToQuat();
+
+		DrawDebugCapsule(GetWorld(), (Frame.Start[i] + Frame.End[i]) * 0.5f, Axis.Size() * 0.5f + Radii[i], Radii[i], Rotation, Color, false, 1.0f);
+	}
+}
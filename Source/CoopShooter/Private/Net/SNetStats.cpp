@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/SNetStats.h"
+#include "Misc/FileHelper.h"
+
+TMap<TPair<FName, FName>, FSNetStatsEntry> FSNetStats::RPCs;
+TMap<TPair<FName, FName>, FSNetStatsEntry> FSNetStats::Properties;
+TMap<FString, FSNetStats::FConnectionStats> FSNetStats::Connections;
+
+void FSNetStats::RecordRPC(FName OwnerClass, FName FunctionName, int64 Bits)
+{
+	FSNetStatsEntry& Entry = RPCs.FindOrAdd(TPair<FName, FName>(OwnerClass, FunctionName));
+	Entry.Count++;
+	Entry.Bits += Bits;
+}
+
+void FSNetStats::RecordProperty(FName OwnerClass, FName PropertyName, int64 Bits)
+{
+	FSNetStatsEntry& Entry = Properties.FindOrAdd(TPair<FName, FName>(OwnerClass, PropertyName));
+	Entry.Count++;
+	Entry.Bits += Bits;
+}
+
+void FSNetStats::RecordConnectionSample(const FString& ConnectionName, int32 BytesPerSecond, bool bOverBudget)
+{
+	FConnectionStats& Stats = Connections.FindOrAdd(ConnectionName);
+	Stats.NumSamples++;
+	Stats.TotalBytesPerSecond += BytesPerSecond;
+	Stats.PeakBytesPerSecond = FMath::Max(Stats.PeakBytesPerSecond, BytesPerSecond);
+
+	if (bOverBudget)
+	{
+		Stats.NumOverBudget++;
+	}
+}
+
+void FSNetStats::Reset()
+{
+	RPCs.Empty();
+	Properties.Empty();
+	Connections.Empty();
+}
+
+bool FSNetStats::WriteCSV(const FString& Filename, float Duration)
+{
+	const float SafeDuration = FMath::Max(Duration, 1.0f);
+
+	FString CSV = TEXT("Type,Owner,Name,Count,Bytes,BytesPerSecond,PeakBytesPerSecond,SamplesOverBudget\n");
+
+	for (const TPair<TPair<FName, FName>, FSNetStatsEntry>& RPC : RPCs)
+	{
+		const int64 Bytes = (RPC.Value.Bits + 7) / 8;
+		CSV += FString::Printf(TEXT("RPC,%s,%s,%lld,%lld,%.1f,,\n"), *RPC.Key.Key.ToString(), *RPC.Key.Value.ToString(), RPC.Value.Count, Bytes, Bytes / SafeDuration);
+	}
+
+	for (const TPair<TPair<FName, FName>, FSNetStatsEntry>& Property : Properties)
+	{
+		const int64 Bytes = (Property.Value.Bits + 7) / 8;
+		CSV += FString::Printf(TEXT("Property,%s,%s,%lld,%lld,%.1f,,\n"), *Property.Key.Key.ToString(), *Property.Key.Value.ToString(), Property.Value.Count, Bytes, Bytes / SafeDuration);
+	}
+
+	for (const TPair<FString, FConnectionStats>& Connection : Connections)
+	{
+		const float Average = Connection.Value.NumSamples > 0 ? (float)Connection.Value.TotalBytesPerSecond / Connection.Value.NumSamples : 0.0f;
+		CSV += FString::Printf(TEXT("Connection,,%s,%lld,,%.1f,%d,%d\n"), *Connection.Key, Connection.Value.NumSamples, Average, Connection.Value.PeakBytesPerSecond, Connection.Value.NumOverBudget);
+	}
+
+	return FFileHelper::SaveStringToFile(CSV, *Filename);
+}
+
+void FSNetStats::Dump(float Duration)
+{
+	const float SafeDuration = FMath::Max(Duration, 1.0f);
+
+	UE_LOG(LogTemp, Log, TEXT("CoopShooter net stats over %.1f seconds"), Duration);
+
+	for (const TPair<TPair<FName, FName>, FSNetStatsEntry>& RPC : RPCs)
+	{
+		UE_LOG(LogTemp, Log, TEXT("  RPC %s::%s count %lld, %.1f bytes/s"), *RPC.Key.Key.ToString(), *RPC.Key.Value.ToString(), RPC.Value.Count, RPC.Value.Bits / 8.0f / SafeDuration);
+	}
+
+	for (const TPair<TPair<FName, FName>, FSNetStatsEntry>& Property : Properties)
+	{
+		UE_LOG(LogTemp, Log, TEXT("  Property %s::%s count %lld, %.1f bytes/s"), *Property.Key.Key.ToString(), *Property.Key.Value.ToString(), Property.Value.Count, Property.Value.Bits / 8.0f / SafeDuration);
+	}
+
+	for (const TPair<FString, FConnectionStats>& Connection : Connections)
+	{
+		const float Average = Connection.Value.NumSamples > 0 ? (float)Connection.Value.TotalBytesPerSecond / Connection.Value.NumSamples : 0.0f;
+		UE_LOG(LogTemp, Log, TEXT("  Connection %s average %.1f bytes/s, peak %d bytes/s, %d samples over budget"), *Connection.Key, Average, Connection.Value.PeakBytesPerSecond, Connection.Value.NumOverBudget);
+	}
+}
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/SReplicationGraph.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/LevelScriptActor.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "SCharacter.h"
+#include "SWeapon.h"
+#include "SWeaponPickup.h"
+
+static int32 ReplicationGraphEnabled = 1;
+FAutoConsoleVariableRef CVARReplicationGraphEnabled(
+	TEXT("COOP.RepGraph"),
+	ReplicationGraphEnabled,
+	TEXT("Use the CoopShooter replication graph for net drivers created from now on"),
+	ECVF_Default);
+
+static float ReplicationGraphCellSize = 10000.0f;
+FAutoConsoleVariableRef CVARReplicationGraphCellSize(
+	TEXT("COOP.RepGraph.CellSize"),
+	ReplicationGraphCellSize,
+	TEXT("The size of a spatialization grid cell, read when the graph is created"),
+	ECVF_Default);
+
+static float ReplicationGraphSpatialBias = -150000.0f;
+FAutoConsoleVariableRef CVARReplicationGraphSpatialBias(
+	TEXT("COOP.RepGraph.SpatialBias"),
+	ReplicationGraphSpatialBias,
+	TEXT("Offset of the spatialization grid origin on both axes, should be below the lowest coordinate of the level"),
+	ECVF_Default);
+
+USReplicationGraph::USReplicationGraph()
+{
+	GridNode = nullptr;
+	AlwaysRelevantNode = nullptr;
+}
+
+void USReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Our own classes are routed explicitly, everything else is worked out from its defaults below
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), EClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(ASCharacter::StaticClass(), EClassRepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(ASWeapon::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(ASWeaponPickup::StaticClass(), EClassRepNodeMapping::Spatialize_Dormancy);
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+
+		if (!ActorCDO || !ActorCDO->GetIsReplicated())
+			continue;
+
+		// Skip blueprint compilation leftovers
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+			continue;
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+		ClassInfo.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+
+		if (!ClassRepNodePolicies.Get(Class))
+		{
+			ClassRepNodePolicies.Set(Class, GetMappingPolicy(Class));
+		}
+	}
+}
+
+void USReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = ReplicationGraphCellSize;
+	GridNode->SpatialBias = FVector2D(ReplicationGraphSpatialBias, ReplicationGraphSpatialBias);
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void USReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	USReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<USReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+}
+
+void USReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	const EClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(ActorInfo.Class);
+
+	switch (Policy ? *Policy : EClassRepNodeMapping::Spatialize_Dynamic)
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void USReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	const EClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(ActorInfo.Class);
+
+	switch (Policy ? *Policy : EClassRepNodeMapping::Spatialize_Dynamic)
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void USReplicationGraph::OnCharacterWeaponChanged(ASCharacter* Character, ASWeapon* NewWeapon, ASWeapon* OldWeapon)
+{
+	if (!Character)
+		return;
+
+	FGlobalActorReplicationInfo& CharacterInfo = GlobalActorReplicationInfoMap.Get(Character);
+	CharacterInfo.DependentActorList.PrepareForWrite();
+
+	if (OldWeapon)
+	{
+		CharacterInfo.DependentActorList.RemoveFast(OldWeapon);
+
+		// Weapons are not routed, so this one is never gathered again and its channels would only close once it goes
+		// dormant, leaving clients with the last state they got. Closing for relevancy destroys their copy instead
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			UActorChannel* Channel = Connection ? Connection->FindActorChannelRef(OldWeapon) : nullptr;
+			if (Channel)
+			{
+				Channel->Close(EChannelCloseReason::Relevancy);
+			}
+		}
+	}
+
+	if (NewWeapon && !CharacterInfo.DependentActorList.Contains(NewWeapon))
+	{
+		CharacterInfo.DependentActorList.Add(NewWeapon);
+	}
+}
+
+USReplicationGraph* USReplicationGraph::Get(const UWorld* World)
+{
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+
+	return NetDriver ? NetDriver->GetReplicationDriver<USReplicationGraph>() : nullptr;
+}
+
+UReplicationDriver* USReplicationGraph::CreateReplicationDriver(UNetDriver* ForNetDriver, const FURL& URL, UWorld* World)
+{
+	// Beacons and demo recording keep the default replication
+	if (ReplicationGraphEnabled <= 0 || !ForNetDriver || ForNetDriver->NetDriverName != NAME_GameNetDriver)
+		return nullptr;
+
+	return NewObject<USReplicationGraph>(GetTransientPackage());
+}
+
+EClassRepNodeMapping USReplicationGraph::GetMappingPolicy(UClass* Class) const
+{
+	AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+
+	if (ActorCDO->bAlwaysRelevant)
+		return EClassRepNodeMapping::RelevantAllConnections;
+
+	// Player controllers and anything else only the owner sees go through the connection node
+	if (ActorCDO->bOnlyRelevantToOwner)
+		return EClassRepNodeMapping::NotRouted;
+
+	USceneComponent* RootComponent = ActorCDO->GetRootComponent();
+	if (RootComponent && RootComponent->Mobility == EComponentMobility::Static)
+		return EClassRepNodeMapping::Spatialize_Static;
+
+	return EClassRepNodeMapping::Spatialize_Dynamic;
+}
+
+void USReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	UNetConnection* NetConnection = Params.ConnectionManager.NetConnection;
+
+	ReplicationActorList.Reset();
+	ReplicationActorList.ConditionalAdd(NetConnection->PlayerController);
+	ReplicationActorList.ConditionalAdd(NetConnection->ViewTarget);
+
+	Super::GatherActorListsForConnection(Params);
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/SShotBatch.h"
+
+bool FSShotBatch::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint32 NumShots = FMath::Min(Shots.Num(), MaxShots);
+	Ar.SerializeInt(NumShots, MaxShots + 1);
+
+	if (Ar.IsLoading())
+	{
+		Shots.SetNum(NumShots);
+	}
+
+	if (NumShots == 0)
+		return true;
+
+	// Every other shot is stored as an offset from the first shots sequence and from the earliest time in the batch.
+	// Shots are not always in time order, a shot from a later frame can be timed before one from an earlier frame
+	uint16 FirstSequence = Shots[0].Sequence;
+	float BaseTimestamp = Shots[0].Timestamp;
+	if (Ar.IsSaving())
+	{
+		for (uint32 i = 1; i < NumShots; i++)
+		{
+			BaseTimestamp = FMath::Min(BaseTimestamp, Shots[i].Timestamp);
+		}
+	}
+
+	Ar << FirstSequence;
+	Ar << BaseTimestamp;
+
+	for (uint32 i = 0; i < NumShots; i++)
+	{
+		FSShotRecord& Shot = Shots[i];
+
+		bOutSuccess &= SerializePackedVector<1, 20>(Shot.Origin, Ar);
+
+		uint16 Pitch = FRotator::CompressAxisToShort(Shot.AimRotation.Pitch);
+		uint16 Yaw = FRotator::CompressAxisToShort(Shot.AimRotation.Yaw);
+		Ar << Pitch;
+		Ar << Yaw;
+
+		// Milliseconds since the earliest shot of the batch
+		uint16 TimeOffset = (uint16)FMath::Clamp(FMath::RoundToInt((Shot.Timestamp - BaseTimestamp) * 1000.0f), 0, (int32)MAX_uint16);
+		Ar << TimeOffset;
+
+		if (Ar.IsLoading())
+		{
+			Shot.Sequence = (uint16)(FirstSequence + i);
+			Shot.AimRotation = FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f);
+			Shot.Timestamp = BaseTimestamp + TimeOffset / 1000.0f;
+		}
+	}
+
+	return true;
+}
+
+bool FSShotAckBatch::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint32 NumAcks = FMath::Min(Acks.Num(), MaxAcks);
+	Ar.SerializeInt(NumAcks, MaxAcks + 1);
+
+	if (Ar.IsLoading())
+	{
+		Acks.SetNum(NumAcks);
+	}
+
+	for (uint32 i = 0; i < NumAcks; i++)
+	{
+		FSShotAck& Ack = Acks[i];
+
+		// Shots are processed in order, the full sequence is only needed after a gap
+		uint8 bConsecutive = i > 0 && Ack.Sequence == (uint16)(Acks[i - 1].Sequence + 1);
+		if (i > 0)
+		{
+			Ar.SerializeBits(&bConsecutive, 1);
+		}
+
+		if (bConsecutive)
+		{
+			Ack.Sequence = (uint16)(Acks[i - 1].Sequence + 1);
+		}
+		else
+		{
+			Ar << Ack.Sequence;
+		}
+
+		uint8 bHit = Ack.bHit;
+		Ar.SerializeBits(&bHit, 1);
+		Ack.bHit = bHit != 0;
+	}
+
+	return true;
+}
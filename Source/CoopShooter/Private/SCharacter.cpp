@@ -11,6 +11,12 @@
 #include "Components/CapsuleComponent.h"
 #include "CoopShooter.h"
 #include "SHealthComponent.h"
+#include "Components/SLagCompensationComponent.h"
+#include "Components/SCameraSwayComponent.h"
+#include "Components/SCharacterMovementComponent.h"
+#include "Components/SInventoryComponent.h"
+#include "Subsystems/SAssetStreamingSubsystem.h"
+#include "Subsystems/SCorpseSubsystem.h"
 #include "Gameframework/CharacterMovementComponent.h"
 #include "TimerManager.h"
 #include "SWeaponPickup.h"
@@ -19,10 +25,18 @@
 #include "Kismet/KismetMathLibrary.h" // For look at rotation
 
 // Sets default values
-ASCharacter::ASCharacter()
+ASCharacter::ASCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+ 	// Only ticks while the ADS or death camera is moving
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	SCharacterMovement = Cast<USCharacterMovementComponent>(GetCharacterMovement());
+
+	GetMovementComponent()->GetNavAgentPropertiesRef().bCanCrouch = true;
+
+	GetCapsuleComponent()->SetCollisionResponseToChannel(COLLISION_WEAPON, ECR_Ignore);
 
 	// Create the default spring arm comp
 	SpringArmComponent = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArmComponent"));
@@ -30,32 +44,36 @@ ASCharacter::ASCharacter()
 	SpringArmComponent->SetupAttachment(RootComponent);
 	SpringArmComponent->TargetArmLength = 200.f;
 
-	GetMovementComponent()->GetNavAgentPropertiesRef().bCanCrouch = true;
-
-	GetCapsuleComponent()->SetCollisionResponseToChannel(COLLISION_WEAPON, ECR_Ignore);
-
 	// Create the camera component
 	CameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("CameraComponent"));
 	CameraComponent->SetupAttachment(SpringArmComponent);
 
+	// Create the camera sway component
+	CameraSwayComponent = CreateDefaultSubobject<USCameraSwayComponent>(TEXT("CameraSwayComponent"));
+
 	// Create the post fx component
 	PostProcessComponent = CreateDefaultSubobject<UPostProcessComponent>(TEXT("PostFXComponent"));
-	PostFXDamage.bOverride_ColorSaturation = true;
 
 	// Create the health component
 	HealthComponentProtected = CreateDefaultSubobject<USHealthComponent>(TEXT("HealthComponent"));
 
+	// Create the lag compensation component
+	LagCompensationComponent = CreateDefaultSubobject<USLagCompensationComponent>(TEXT("LagCompensationComponent"));
+
+	// Create the inventory component
+	InventoryComponent = CreateDefaultSubobject<USInventoryComponent>(TEXT("InventoryComponent"));
+
 	// Setup the viewport
 	ViewPort = EViewportEnum::VE_Right;
 
 	// defaults 
 	ADSFOV = 65.0f;
 	ADSInterpSpeed = 20.0f;
-	WeaponAttachSocketName = "weapon_socket";
-	RifleHolsterName = "weapon_rifle_holster";
 	bIsCharacterRagdoll = false;
-	bIsCheckingFall = false;
+	bIsAiming = false;
 	bIsDead = false;
+	bRequestedWeaponClasses = false;
+	bRequestedDroppedWeaponClass = false;
 
 
 	NetUpdateFrequency = 66.0f;
@@ -67,8 +85,19 @@ void ASCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 	
-	DefaultFOV = CameraComponent->FieldOfView;
-	HealthComponentProtected->OnHealthChanged.AddDynamic(this, &ASCharacter::OnHealthChanged);
+	HealthComponentProtected->OnHealthChangedNative.AddUObject(this, &ASCharacter::OnHealthChanged);
+
+	// Nothing ever looks through a character on a dedicated server, free the components only used for that
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		DestroyCosmeticComponents();
+	}
+
+	if (CameraComponent)
+		DefaultFOV = CameraComponent->FieldOfView;
+
+	if (CameraSwayComponent)
+		CameraSwayComponent->SetCameraShakes(IdleCamSway, HorMovementCameraShake, VerMovementCameraShake);
 
 	if (Role == ROLE_Authority)
 	{
@@ -80,28 +109,12 @@ void ASCharacter::BeginPlay()
 void ASCharacter::MoveForward(float Val)
 {
 	AddMovementInput(GetActorForwardVector() * Val);
-
-	APlayerController* PC = Cast<APlayerController>(GetController());
-
-	if (PC && HorMovementCameraShake)
-	{
-		if (GetVelocity().Y > 0.1 || GetVelocity().Y < -0.1)
-			PC->ClientPlayCameraShake(HorMovementCameraShake);
-	}
 }
 
 /** Move the player right */
 void ASCharacter::MoveRight(float Val)
 {
 	AddMovementInput(GetActorRightVector() * Val);
-
-	APlayerController* PC = Cast<APlayerController>(GetController());
-
-	if (PC && VerMovementCameraShake)
-	{
-		if (GetVelocity().X > 0.1 || GetVelocity().X < -0.1)
-			PC->ClientPlayCameraShake(VerMovementCameraShake);
-	}
 }
 
 void ASCharacter::BeginCrouch()
@@ -116,50 +129,94 @@ void ASCharacter::EndCrouch()
 
 void ASCharacter::BeginADS()
 {
-	bADS = true;
+	if (SCharacterMovement)
+		SCharacterMovement->bWantsToAim = true;
+
+	SetActorTickEnabled(true);
 }
 
 void ASCharacter::EndADS()
 {
-	bADS = false;
+	if (SCharacterMovement)
+		SCharacterMovement->bWantsToAim = false;
+
+	SetActorTickEnabled(true);
+}
+
+void ASCharacter::BeginSprint()
+{
+	if (SCharacterMovement)
+		SCharacterMovement->bWantsToSprint = true;
+}
+
+void ASCharacter::EndSprint()
+{
+	if (SCharacterMovement)
+		SCharacterMovement->bWantsToSprint = false;
+}
+
+bool ASCharacter::IsAiming() const
+{
+	if (Role == ROLE_SimulatedProxy)
+		return bIsAiming;
+
+	return SCharacterMovement && SCharacterMovement->bWantsToAim;
+}
+
+void ASCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	bIsAiming = IsAiming();
 }
 
 void ASCharacter::StartFire()
 {
+	ASWeapon* CurrentWeapon = GetCurrentWeapon();
 	if (CurrentWeapon)
 		CurrentWeapon->BeginFire();
 }
 
 void ASCharacter::EndFire()
 {
+	ASWeapon* CurrentWeapon = GetCurrentWeapon();
 	if (CurrentWeapon)
 		CurrentWeapon->EndFire();
 }
 
+ASWeapon* ASCharacter::GetCurrentWeapon() const
+{
+	return InventoryComponent->GetEquippedWeapon();
+}
+
+void ASCharacter::SwitchWeapon()
+{
+	if (bIsDead)
+		return;
+
+	// The weapon being put away stops firing, the new one starts when fire is pressed again
+	EndFire();
+	InventoryComponent->EquipNextWeapon();
+}
+
 void ASCharacter::OnHealthChanged(USHealthComponent* HealthComponent, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
 {
-	if (Role == ROLE_Authority)
+	// Clients get here from the replicated health, so the post fx is only ever applied where it is seen
+	if (IsLocallyControlled())
 	{
-		/* TODO: Fix bug where damage to other entities calls this to fire */
-		if (Health <= 30 && Health > 20)
-		{
-			this->PostFXDamage.ColorSaturation.Set(1.0f, 1.0f, 1.0f, 0.6f);
-			this->PostProcessComponent->Settings = PostFXDamage;
-		}
-		else if (Health <= 20 && Health > 10)
-		{
-			this->PostFXDamage.ColorSaturation.Set(1.0f, 1.0f, 1.0f, 0.3f);
-			this->PostProcessComponent->Settings = PostFXDamage;
-		}
-		else if (Health <= 10)
+		UpdateDamagePostFX(Health);
+
+		if (PostProcessComponent && HealthComponent->IsRegenerating())
 		{
-			this->PostFXDamage.ColorSaturation.Set(1.0f, 1.0f, 1.0f, 0.1f);
-			this->PostProcessComponent->Settings = PostFXDamage;
+			SetActorTickEnabled(true);
 		}
 	}
 
 	if (Health <= 0.0f)
 	{
+		if (bIsDead)
+			return;
+
 		Health = 0.0f;
 
 		GetMovementComponent()->StopMovementImmediately();
@@ -168,23 +225,71 @@ void ASCharacter::OnHealthChanged(USHealthComponent* HealthComponent, float Heal
 		ActivateRagdoll();
 		bIsDead = true;
 
-		GetWorldTimerManager().SetTimer(TimerHandle_WeaponDetatchTimer, this, &ASCharacter::DetatchWeapon, 2, false);
-		return;
-	}
-	else {
-		if (Health == 100)
+		// Corpses can not be shot, keep them out of the rewind history and the hitbox broadphase
+		if (LagCompensationComponent)
 		{
-			GetWorldTimerManager().ClearTimer(TimerHandle_HealthCharacter);
-			return;
+			LagCompensationComponent->StopRecording();
 		}
+		SetActorTickEnabled(true);
 
-		GetWorldTimerManager().SetTimer(TimerHandle_FallChecker, this, &ASCharacter::Heal, .5, true, 5);
-		UE_LOG(LogTemp, Warning, TEXT("%f"), Health);
+		if (Role == ROLE_Authority)
+		{
+			GetWorldTimerManager().SetTimer(TimerHandle_WeaponDetatchTimer, this, &ASCharacter::DetatchWeapon, 2, false);
+		}
+		return;
+	}
+}
+
+void ASCharacter::UpdateDamagePostFX(float Health)
+{
+	float Saturation = 1.0f;
+
+	if (Health <= 10)
+		Saturation = 0.1f;
+	else if (Health <= 20)
+		Saturation = 0.3f;
+	else if (Health <= 30)
+		Saturation = 0.6f;
+
+	if (!PostProcessComponent)
+		return;
+
+	PostProcessComponent->Settings.bOverride_ColorSaturation = true;
+	PostProcessComponent->Settings.ColorSaturation.Set(1.0f, 1.0f, 1.0f, Saturation);
+}
+
+void ASCharacter::DestroyCosmeticComponents()
+{
+	if (PostProcessComponent)
+	{
+		PostProcessComponent->DestroyComponent();
+		PostProcessComponent = nullptr;
+	}
+
+	if (CameraSwayComponent)
+	{
+		CameraSwayComponent->DestroyComponent();
+		CameraSwayComponent = nullptr;
+	}
+
+	if (CameraComponent)
+	{
+		CameraComponent->DestroyComponent();
+		CameraComponent = nullptr;
+	}
+
+	if (SpringArmComponent)
+	{
+		SpringArmComponent->DestroyComponent();
+		SpringArmComponent = nullptr;
 	}
 }
 
 void ASCharacter::SwitchViewport()
 {
+	if (!SpringArmComponent)
+		return;
+
 	if (ViewPort == EViewportEnum::VE_Right)
 	{
 		ViewPort = EViewportEnum::VE_Left;
@@ -202,33 +307,61 @@ void ASCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	ADSCheck(DeltaTime);
-	UpdateCameraSway();
+	bool bADSTransition = ADSCheck(DeltaTime);
+	bool bDeadCameraMoving = bIsDead && UpdateDeadCamera(DeltaTime);
+
+	// Regenerated health is never broadcast, so the post fx follows it here, only the local player's is ever set
+	bool bPostFXRegenerating = PostProcessComponent && IsLocallyControlled() && HealthComponentProtected->IsRegenerating();
+	if (bPostFXRegenerating)
+	{
+		UpdateDamagePostFX(HealthComponentProtected->GetHealth());
+	}
+
+	// Nothing left to move, sleep until the next ADS input, damage or death
+	if (!bADSTransition && !bDeadCameraMoving && !bPostFXRegenerating)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void ASCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+	if (Role < ROLE_Authority)
+		return;
 
-	if (!bIsCheckingFall && GetMovementComponent()->IsFalling())
+	// Falling for too long kills, landing or any other mode change disarms it
+	if (GetCharacterMovement()->MovementMode == MOVE_Falling)
 	{
 		GetWorldTimerManager().SetTimer(TimerHandle_FallChecker, this, &ASCharacter::Kill, 2, false);
-		bIsCheckingFall = true;
 	}
-	else if (bIsCheckingFall && !GetMovementComponent()->IsFalling())
+	else
 	{
-		bIsCheckingFall = false;
 		GetWorldTimerManager().ClearTimer(TimerHandle_FallChecker);
 	}
+}
 
-	if (bIsDead)
-	{
-		// Get the camera location
-		FVector CameraLocation = CameraComponent->GetComponentLocation();
-		FVector MeshLocation = GetMesh()->GetComponentLocation();	
-		FRotator NewCameraRotation = UKismetMathLibrary::FindLookAtRotation(CameraLocation, MeshLocation);
+bool ASCharacter::UpdateDeadCamera(float DeltaTime)
+{
+	if (!CameraComponent)
+		return false;
 
-		float NewRotX = FMath::FInterpTo(CameraComponent->GetComponentRotation().Pitch, NewCameraRotation.Pitch, DeltaTime, 2);
-		float NewRotY = FMath::FInterpTo(CameraComponent->GetComponentRotation().Yaw, NewCameraRotation.Yaw, DeltaTime, 2);
-		float NewRotZ = FMath::FInterpTo(CameraComponent->GetComponentRotation().Roll, NewCameraRotation.Roll, DeltaTime, 2);
+	// Get the camera location
+	FVector CameraLocation = CameraComponent->GetComponentLocation();
+	FVector MeshLocation = GetMesh()->GetComponentLocation();	
+	FRotator NewCameraRotation = UKismetMathLibrary::FindLookAtRotation(CameraLocation, MeshLocation);
 
-		CameraComponent->SetWorldRotation(FRotator(NewRotX,NewRotY,NewRotZ));
-	}
+	float NewRotX = FMath::FInterpTo(CameraComponent->GetComponentRotation().Pitch, NewCameraRotation.Pitch, DeltaTime, 2);
+	float NewRotY = FMath::FInterpTo(CameraComponent->GetComponentRotation().Yaw, NewCameraRotation.Yaw, DeltaTime, 2);
+	float NewRotZ = FMath::FInterpTo(CameraComponent->GetComponentRotation().Roll, NewCameraRotation.Roll, DeltaTime, 2);
+
+	CameraComponent->SetWorldRotation(FRotator(NewRotX,NewRotY,NewRotZ));
+
+	// Keep following while the ragdoll is still moving
+	bool bRagdollMoving = GetMesh()->IsSimulatingPhysics() && GetMesh()->GetPhysicsLinearVelocity().SizeSquared() > 1.0f;
+
+	return bRagdollMoving || !CameraComponent->GetComponentRotation().Equals(NewCameraRotation, 0.5f);
 }
 
 // Called to bind functionality to input
@@ -249,6 +382,9 @@ void ASCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 
 	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
 
+	PlayerInputComponent->BindAction("Sprint", IE_Pressed, this, &ASCharacter::BeginSprint);
+	PlayerInputComponent->BindAction("Sprint", IE_Released, this, &ASCharacter::EndSprint);
+
 	// Bind the action for switching the character viewport
 	PlayerInputComponent->BindAction("CameraView", IE_Pressed, this, &ASCharacter::SwitchViewport);
 
@@ -259,6 +395,8 @@ void ASCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &ASCharacter::StartFire);
 	PlayerInputComponent->BindAction("Fire", IE_Released, this, &ASCharacter::EndFire);
 
+	PlayerInputComponent->BindAction("SwitchWeapon", IE_Pressed, this, &ASCharacter::SwitchWeapon);
+
 	// Testing key
 	PlayerInputComponent->BindAction("TestKey", IE_Pressed, this, &ASCharacter::TestFunction);
 
@@ -272,47 +410,62 @@ FVector ASCharacter::GetPawnViewLocation() const
 	return Super::GetPawnViewLocation();
 }
 
-void ASCharacter::ADSCheck(float DeltaTime)
+void ASCharacter::PawnClientRestart()
 {
-	float TargetFOV = bADS ? ADSFOV : DefaultFOV;
-	float NewFOV = FMath::FInterpTo(CameraComponent->FieldOfView, TargetFOV, DeltaTime, ADSInterpSpeed);
+	Super::PawnClientRestart();
 
-	CameraComponent->SetFieldOfView(NewFOV);
+	// Only called on the machine that controls this pawn
+	if (CameraSwayComponent)
+		CameraSwayComponent->SetSwayEnabled(IsLocallyControlled());
 }
 
-void ASCharacter::UpdateCameraSway()
+void ASCharacter::UnPossessed()
 {
-	APlayerController* PC = Cast<APlayerController>(GetController());
+	Super::UnPossessed();
+
+	if (CameraSwayComponent)
+		CameraSwayComponent->SetSwayEnabled(false);
+}
 
-	if (PC && IdleCamSway)
+bool ASCharacter::ADSCheck(float DeltaTime)
+{
+	if (!CameraComponent)
+		return false;
+
+	float TargetFOV = IsAiming() ? ADSFOV : DefaultFOV;
+
+	if (FMath::IsNearlyEqual(CameraComponent->FieldOfView, TargetFOV, 0.01f))
 	{
-		if (GetVelocity() == FVector::ZeroVector)
-			PC->ClientPlayCameraShake(IdleCamSway);
+		CameraComponent->SetFieldOfView(TargetFOV);
+		return false;
 	}
+
+	float NewFOV = FMath::FInterpTo(CameraComponent->FieldOfView, TargetFOV, DeltaTime, ADSInterpSpeed);
+
+	CameraComponent->SetFieldOfView(NewFOV);
+	return true;
 }
 
 void ASCharacter::SpawnWeapons()
 {
-	// Spawn a default weapon
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	CurrentWeapon = GetWorld()->SpawnActor<ASWeapon>(StarterWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+	// Stream the weapon classes in first unless the map manifest already has
+	USAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<USAssetStreamingSubsystem>();
+	bool bWeaponClassesLoaded = (StarterWeaponClass.IsNull() || StarterWeaponClass.Get()) && (HolsteredWeaponClass.IsNull() || HolsteredWeaponClass.Get());
 
-	if (CurrentWeapon)
+	if (!bWeaponClassesLoaded && Streaming && !bRequestedWeaponClasses)
 	{
-		CurrentWeapon->SetOwner(this);
-		CurrentWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, WeaponAttachSocketName);
+		bRequestedWeaponClasses = true;
+		Streaming->RequestLoad({ StarterWeaponClass.ToSoftObjectPath(), HolsteredWeaponClass.ToSoftObjectPath() }, false, FStreamableDelegate::CreateUObject(this, &ASCharacter::SpawnWeapons));
+		return;
 	}
 
-	// Spawn holstered weapon
-	FActorSpawnParameters SpawnParamsHolster;
-	SpawnParamsHolster.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-	HolsteredWeapon = GetWorld()->SpawnActor<ASWeapon>(HolsteredWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParamsHolster);
+	// The holstered weapon is only a record until it is equipped
+	int32 StarterSlot = InventoryComponent->AddWeapon(StarterWeaponClass.Get());
+	InventoryComponent->AddWeapon(HolsteredWeaponClass.Get());
 
-	if (HolsteredWeapon)
+	if (StarterSlot != INDEX_NONE)
 	{
-		HolsteredWeapon->SetOwner(this);
-		HolsteredWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, RifleHolsterName);
+		InventoryComponent->EquipWeapon(StarterSlot);
 	}
 }
 
@@ -330,55 +483,74 @@ void ASCharacter::ActivateRagdoll()
 			CharacterComponent->SetComponentTickEnabled(false);
 		}
 
-		GetMesh()->SetAllBodiesSimulatePhysics(true);
-		GetMesh()->WakeAllRigidBodies();
-		GetMesh()->bBlendPhysics = true;
-		NetMulticastBeginRagdoll();
+		// Replicated so clients start their own ragdoll, the server never simulates it
+		bIsCharacterRagdoll = true;
+		BeginRagdoll();
 	}
 }
 
 void ASCharacter::BeginRagdoll()
 {
-	GetMesh()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-	GetMesh()->SetSimulatePhysics(true);
-	GetMesh()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	USCorpseSubsystem* CorpseSubsystem = GetWorld()->GetSubsystem<USCorpseSubsystem>();
+	if (CorpseSubsystem)
+	{
+		CorpseSubsystem->AddCorpse(this);
+	}
 }
 
-
-bool ASCharacter::NetMulticastBeginRagdoll_Validate()
+void ASCharacter::OnRep_IsCharacterRagdoll()
 {
-	return true; 
+	if (bIsCharacterRagdoll)
+	{
+		BeginRagdoll();
+	}
 }
 
-void ASCharacter::NetMulticastBeginRagdoll_Implementation() 
-{ 
-	BeginRagdoll(); 
+void ASCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	USCorpseSubsystem* CorpseSubsystem = GetWorld()->GetSubsystem<USCorpseSubsystem>();
+	if (CorpseSubsystem)
+	{
+		CorpseSubsystem->RemoveCorpse(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ASCharacter::DetatchWeapon()
 {
 	// Detatch the current weapon
-	if (CurrentWeapon && CurrentWeapon->DroppedWeapon)
+	ASWeapon* CurrentWeapon = GetCurrentWeapon();
+	if (CurrentWeapon && !CurrentWeapon->DroppedWeapon.IsNull())
 	{
+		// Streamed in when the weapon spawned, if that has not finished yet drop it once it has
+		TSubclassOf<ASWeaponPickup> DroppedWeaponClass = CurrentWeapon->DroppedWeapon.Get();
+		USAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<USAssetStreamingSubsystem>();
+
+		if (!DroppedWeaponClass && Streaming && !bRequestedDroppedWeaponClass)
+		{
+			bRequestedDroppedWeaponClass = true;
+			Streaming->RequestLoad({ CurrentWeapon->DroppedWeapon.ToSoftObjectPath() }, false, FStreamableDelegate::CreateUObject(this, &ASCharacter::DetatchWeapon));
+			return;
+		}
+
+		if (!DroppedWeaponClass)
+			return;
+
 		FActorSpawnParameters SpawnParamsHolster;
 		SpawnParamsHolster.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		ASWeaponPickup* temp = GetWorld()->SpawnActor<ASWeaponPickup>(CurrentWeapon->DroppedWeapon, CurrentWeapon->GetActorLocation(), CurrentWeapon->GetActorRotation(), SpawnParamsHolster);
+		ASWeaponPickup* temp = GetWorld()->SpawnActor<ASWeaponPickup>(DroppedWeaponClass, CurrentWeapon->GetActorLocation(), CurrentWeapon->GetActorRotation(), SpawnParamsHolster);
 
 		if (temp)
 		{
 			GetWorld()->GetTimerManager().ClearTimer(TimerHandle_WeaponDetatchTimer);
-			CurrentWeapon->Destroy();
+
+			// The pickup takes its place, the actor goes back in the pool
+			InventoryComponent->RemoveEquippedWeapon();
 		}
 	}
 }
 
-void ASCharacter::Heal()
-{
-
-	TakeDamageSimple(-10.0f);
-
-}
-
 void ASCharacter::TestFunction()
 {
 	TakeDamageSimple(10.0f);
@@ -401,8 +573,8 @@ void ASCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifet
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(ASCharacter, CurrentWeapon);
-	DOREPLIFETIME(ASCharacter, HolsteredWeapon);
+	DOREPLIFETIME(ASCharacter, bIsCharacterRagdoll);
+	DOREPLIFETIME_CONDITION(ASCharacter, bIsAiming, COND_SimulatedOnly);
 }
 
 //////////////////////////OLD CODE
@@ -2,6 +2,7 @@
 
 
 #include "SWeapon.h"
+#include "SCharacter.h"
 #include "DrawDebugHelpers.h"
 #include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystem.h"
@@ -12,6 +13,18 @@
 #include "TimerManager.h"
 #include "Components/BoxComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "GameFramework/GameStateBase.h"
+#include "Subsystems/SLagCompensationSubsystem.h"
+#include "UObject/CoreNet.h"
+#include "Net/SNetStats.h"
+#include "Subsystems/SParticlePoolSubsystem.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Subsystems/SLoadTestSubsystem.h"
+#include "Subsystems/SAssetStreamingSubsystem.h"
+#include "Subsystems/SFireSchedulerSubsystem.h"
+#include "Subsystems/SDamageSubsystem.h"
+#include "Rules/SGameplayRules.h"
+#include "ProfilingDebugging/ScopedTimers.h"
 
 // Debug commands
 static int32 DeubugWeaponDrawing = 0;
@@ -21,6 +34,57 @@ FAutoConsoleVariableRef CVARDebugWeaponDrawing(
 	TEXT("Draw Debug Lines for Weapons"), 
 	ECVF_Cheat);
 
+static int32 BatchShots = 1;
+FAutoConsoleVariableRef CVARBatchShots(
+	TEXT("COOP.Net.BatchShots"),
+	BatchShots,
+	TEXT("Send all the shots fired in a frame as one unreliable batch instead of a reliable RPC per shot"),
+	ECVF_Default);
+
+static int32 ShotRedundancy = 2;
+FAutoConsoleVariableRef CVARShotRedundancy(
+	TEXT("COOP.Net.ShotRedundancy"),
+	ShotRedundancy,
+	TEXT("How many previously sent shots are resent with every batch to cover packet loss"),
+	ECVF_Default);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("ServerFire RPCs"), STAT_ShotRPCsReliable, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ServerFire Bits"), STAT_ShotRPCBitsReliable, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ServerFireBatch RPCs"), STAT_ShotRPCsBatched, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ServerFireBatch Bits"), STAT_ShotRPCBitsBatched, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Duplicate Shots Dropped"), STAT_DuplicateShotsDropped, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HitScanTraces Bits"), STAT_HitScanTracesBits, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ClientAckShots RPCs"), STAT_ShotAckRPCs, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("ClientAckShots Bits"), STAT_ShotAckBits, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predicted Hits Rolled Back"), STAT_PredictedHitsRolledBack, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hits Missed By Prediction"), STAT_HitsMissedByPrediction, STATGROUP_CoopShooterNet);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Shot Ack Latency (ms)"), STAT_ShotAckLatency, STATGROUP_CoopShooterNet);
+
+static int32 WeaponDormancy = 1;
+FAutoConsoleVariableRef CVARWeaponDormancy(
+	TEXT("COOP.Net.WeaponDormancy"),
+	WeaponDormancy,
+	TEXT("Weapons are dormant and skipped by replication while they are not firing"),
+	ECVF_Default);
+
+static int32 AsyncWeaponTraces = 1;
+FAutoConsoleVariableRef CVARAsyncWeaponTraces(
+	TEXT("COOP.AsyncWeaponTraces"),
+	AsyncWeaponTraces,
+	TEXT("Trace shots on the async trace queue and apply them the next frame instead of tracing inline"),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Resolve Shots"), STAT_WeaponResolveShots, STATGROUP_CoopShooter);
+
+/** Predictions the server has not answered by then are assumed lost and kept as they are */
+static const float MaxPredictionAge = 2.0f;
+
+/** How long a weapon stays awake after its last shot, so a burst does not flip it in and out of dormancy */
+static const float DormancyDelay = 1.0f;
+
+/** How far a client shot can start from the servers view of the shooter before it is corrected */
+static const float MaxShotOriginError = 200.0f;
+
 // Sets default values
 ASWeapon::ASWeapon()
 {
@@ -34,11 +98,34 @@ ASWeapon::ASWeapon()
 	BaseDamage = 20.0f;
 	CritDamage = BaseDamage * 2;
 	RateOfFire = 700;
+	TimeSinceLastShot = -BIG_NUMBER;
+	PelletCount = 1;
+	PelletSpread = 0.0f;
+	AimSpreadMultiplier = 0.5f;
+
+	// Only ticks on the frames it has traces to resolve or acks to send, queued shots are sent from OnWorldPostActorTick
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	NumUnsentShots = 0;
+	NextShotSequence = 0;
+	LastProcessedShotSequence = 0;
+	bHasProcessedShot = false;
+	LastPlayedShotIndex = 0;
+	bHasPlayedHitScanTrace = false;
+	CurrentShot.bPredictedHit = false;
 
 	SetReplicates(true);
 
 	NetUpdateFrequency = 66.0f;
 	MinNetUpdateFrequency = 33.0f;
+
+	// Nothing replicates until the weapon fires
+	NetDormancy = DORM_DormantAll;
+	LastServerShotTime = 0.0f;
+
+	ShotTraceDelegate.BindUObject(this, &ASWeapon::OnShotTraceDone);
 }
 
 
@@ -46,148 +133,947 @@ void ASWeapon::BeginPlay()
 {
 	Super::BeginPlay();
 
-	TimeBetweenShots = 60 / RateOfFire;
+	TimeBetweenShots = SGameplayRules::GetTimeBetweenShots(RateOfFire);
+
+	if (Role == ROLE_Authority && WeaponDormancy <= 0)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+
+	USAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<USAssetStreamingSubsystem>();
+	if (Streaming)
+	{
+		// The pickup is only spawned by the server
+		if (Role == ROLE_Authority)
+		{
+			Streaming->RequestLoad({ DroppedWeapon.ToSoftObjectPath() }, false);
+		}
+
+		TArray<FSoftObjectPath> CosmeticAssets = { MuzzleEffect.ToSoftObjectPath(), TracerEffect.ToSoftObjectPath(), DefaultImpactEffect.ToSoftObjectPath(), FleshImpactEffect.ToSoftObjectPath(), FireCamShake.ToSoftObjectPath() };
+		Streaming->RequestLoad(CosmeticAssets, true, FStreamableDelegate::CreateUObject(this, &ASWeapon::OnCosmeticAssetsLoaded));
+	}
+}
+
+void ASWeapon::OnCosmeticAssetsLoaded()
+{
+	// Have the effects ready before the first shot
+	USParticlePoolSubsystem* ParticlePool = GetWorld()->GetSubsystem<USParticlePoolSubsystem>();
+	if (ParticlePool)
+	{
+		ParticlePool->Preallocate(MuzzleEffect.Get(), 2);
+		ParticlePool->Preallocate(TracerEffect.Get(), FMath::Max(4, PelletCount));
+		ParticlePool->Preallocate(DefaultImpactEffect.Get(), FMath::Max(4, PelletCount));
+		ParticlePool->Preallocate(FleshImpactEffect.Get(), FMath::Max(4, PelletCount));
+	}
 }
 
 
-void ASWeapon::Fire()
+void ASWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	USFireSchedulerSubsystem* FireScheduler = GetWorld()->GetSubsystem<USFireSchedulerSubsystem>();
+	if (FireScheduler)
+	{
+		FireScheduler->StopFiring(this);
+	}
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PostActorTickHandle.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASWeapon::Fire(const FVector& EyeLocation, const FRotator& EyeRotation, float ShotAge)
 {
 	// Trace the world, from pawn eyes to crosshair location
+	AActor* MyOwner = GetOwner();
 
-	if (Role < ROLE_Authority)
+	if (MyOwner)
+	{
+		FVector ShotDirection = EyeRotation.Vector();
+
+		const uint16 ShotSequence = NextShotSequence++;
+
+		if (Role < ROLE_Authority)
+		{
+			// The server rewinds to when the shot was due, not to when this frame got round to it
+			float Timestamp = GetServerWorldTimeSeconds() - ShotAge;
+
+			if (BatchShots > 0)
+			{
+				QueueShot(ShotSequence, EyeLocation, EyeRotation, Timestamp);
+			}
+			else
+			{
+				ServerFire(EyeLocation, ShotDirection, Timestamp, ShotSequence);
+
+#if !UE_BUILD_SHIPPING
+				FNetBitWriter Writer(nullptr, 256);
+				bool bSuccess = true;
+				uint16 SentSequence = ShotSequence;
+				FVector_NetQuantize(EyeLocation).NetSerialize(Writer, nullptr, bSuccess);
+				FVector_NetQuantizeNormal(ShotDirection).NetSerialize(Writer, nullptr, bSuccess);
+				Writer << Timestamp;
+				Writer << SentSequence;
+
+				INC_DWORD_STAT(STAT_ShotRPCsReliable);
+				INC_DWORD_STAT_BY(STAT_ShotRPCBitsReliable, Writer.GetNumBits());
+#endif
+			}
+		}
+
+		FireShot(EyeLocation, ShotDirection, -1.0f, ShotSequence);
+
+		TimeSinceLastShot = GetWorld()->TimeSeconds - ShotAge;
+	}
+}
+
+void ASWeapon::FireShot(const FVector& EyeLocation, const FVector& ShotDirection, float RewindTime, uint16 ShotSequence)
+{
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(GetOwner());
+	QueryParams.AddIgnoredActor(this);
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	// The world trace only has to find what blocks the shot, simple collision is enough for that
+	const bool bTraceHitboxes = RewindTime > 0.0f || USLagCompensationSubsystem::IsBroadphaseEnabled();
+	QueryParams.bTraceComplex = !bTraceHitboxes;
+
+	// Characters are only hit through their hitboxes, as they are now or where they were when the client fired
+	FCollisionResponseParams ResponseParams;
+	if (bTraceHitboxes)
+	{
+		ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);
+		ResponseParams.CollisionResponse.SetResponse(ECC_PhysicsBody, ECR_Ignore);
+	}
+
+	TArray<FVector, TInlineAllocator<MaxPellets>> PelletDirections;
+	GetPelletDirections(ShotDirection, ShotSequence, PelletDirections);
+
+	// Every pellet goes in the same async batch and is resolved in the same pass
+	for (int32 i = 0; i < PelletDirections.Num(); i++)
 	{
-		ServerFire();
+		FSPendingShot Shot;
+		Shot.EyeLocation = EyeLocation;
+		Shot.AimDirection = ShotDirection;
+		Shot.PelletDirection = PelletDirections[i];
+		Shot.RewindTime = RewindTime;
+		Shot.Sequence = ShotSequence;
+		Shot.bLastPellet = i == PelletDirections.Num() - 1;
+		Shot.bTraceHitboxes = bTraceHitboxes;
+		Shot.bTraceDone = false;
+		Shot.bBlockingHit = false;
+
+		FVector TraceEnd = EyeLocation + (Shot.PelletDirection * 10000);
+
+		if (AsyncWeaponTraces > 0)
+		{
+			USLoadTestSubsystem::NumAsyncWeaponTraces++;
+			Shot.TraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams, ResponseParams, &ShotTraceDelegate);
+			PendingShots.Add(Shot);
+			continue;
+		}
+
+		USLoadTestSubsystem::NumWeaponTraces++;
+
+		{
+			FScopedDurationTimer TraceTimer(USLoadTestSubsystem::WeaponTraceSeconds);
+			Shot.bBlockingHit = GetWorld()->LineTraceSingleByChannel(Shot.Hit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams, ResponseParams);
+		}
+
+		Shot.bTraceDone = true;
+		ApplyShot(Shot);
 	}
+}
 
+void ASWeapon::ApplyShot(FSPendingShot& Shot)
+{
 	AActor* MyOwner = GetOwner();
+	FHitResult& Hit = Shot.Hit;
 
-	if (MyOwner)
+	FVector TraceEnd = Shot.EyeLocation + (Shot.PelletDirection * 10000);
+
+	// Particle "Target" parameter
+	FVector TracerEndPoint = TraceEnd;
+
+	EPhysicalSurface SurfaceType = SurfaceType_Default;
+
+	if (Shot.bBlockingHit)
 	{
-		FVector EyeLocation;
-		FRotator EyeRotation;
-		MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+		SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+	}
 
-		FVector ShotDirection = EyeRotation.Vector();
+	// The hitbox surface tells flesh from head directly
+	if (Shot.bTraceHitboxes)
+	{
+		USLoadTestSubsystem::NumHitboxTraces++;
+		FScopedDurationTimer TraceTimer(USLoadTestSubsystem::HitboxTraceSeconds);
+		Shot.bBlockingHit |= TraceHitboxes(Shot.EyeLocation, TraceEnd, Shot.RewindTime, Hit, SurfaceType);
+	}
 
-		FVector TraceEnd = EyeLocation + (ShotDirection * 10000);
+	if (Shot.bBlockingHit)
+	{
+		// Blocking hit, proccess damage
+		AActor* HitActor = Hit.GetActor();
 
-		FCollisionQueryParams QueryParams;
-		QueryParams.AddIgnoredActor(MyOwner);
-		QueryParams.AddIgnoredActor(this);
-		QueryParams.bTraceComplex = true;
-		QueryParams.bReturnPhysicalMaterial = true;
+		float RealDamage = SGameplayRules::GetHitDamage(BaseDamage, CritDamage, SurfaceType == SURFACE_FLESHVULNERABLE);
 
-		// Particle "Target" parameter
-		FVector TracerEndPoint = TraceEnd;
+		AController* InstigatorController = MyOwner ? MyOwner->GetInstigatorController() : nullptr;
 
-		EPhysicalSurface SurfaceType = SurfaceType_Default;
+		// Characters take their damage from the queue at the end of the frame, anything else directly
+		USDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<USDamageSubsystem>();
+		const float DamageTime = Shot.RewindTime > 0.0f ? Shot.RewindTime : GetWorld()->TimeSeconds;
 
-		FHitResult Hit;
-		if (GetWorld()->LineTraceSingleByChannel(Hit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams))
+		if (!DamageSubsystem || !DamageSubsystem->QueueDamage(HitActor, RealDamage, SurfaceType, InstigatorController, this, DamageType, DamageTime))
 		{
-			// Blocking hit, proccess damage
-			AActor* HitActor = Hit.GetActor();
+			UGameplayStatics::ApplyPointDamage(HitActor, RealDamage, Shot.PelletDirection, Hit, InstigatorController, this, DamageType);
+		}
 
-			SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+		UParticleSystemComponent* ImpactComponent = PlayImpactFX(SurfaceType, Hit.ImpactPoint);
 
-			float RealDamage = BaseDamage;
-			if (SurfaceType == SURFACE_FLESHVULNERABLE)
+		if (Cast<APawn>(HitActor))
+		{
+			CurrentShot.bPredictedHit = true;
+			CurrentShot.HitImpacts.Emplace(ImpactComponent, Hit.ImpactPoint);
+		}
+
+		TracerEndPoint = Hit.ImpactPoint;
+
+		if (DeubugWeaponDrawing > 0)
+		{
+			DrawDebugString(GetWorld(), Hit.Location, FString::SanitizeFloat(RealDamage));
+			DrawDebugSphere(GetWorld(), Hit.ImpactPoint, 5.0, 12, FColor::Yellow, 1, 1);
+		}
+	}
+
+	if (DeubugWeaponDrawing > 0)
+	{
+		DrawDebugLine(GetWorld(), Shot.EyeLocation, TraceEnd, FColor::White, false, 1.0f, 0, 1.0f);
+	}
+
+	// One muzzle flash per shot, one tracer per pellet
+	if (Shot.bLastPellet)
+	{
+		PlayFireFX(TracerEndPoint);
+	}
+	else
+	{
+		PlayTracerFX(TracerEndPoint);
+	}
+
+	if (Shot.bLastPellet)
+	{
+		FinishShot(Shot.Sequence);
+	}
+
+	if (Role == ROLE_Authority && Shot.bLastPellet)
+	{
+		WakeFromDormancy();
+
+		const FVector MuzzleLocation = GetMuzzleLocation();
+
+		// A multi pellet shot only sends its seed and aim, the clients regenerate the pellets
+		if (PelletCount > 1)
+		{
+			HitScanTraces.AddTrace(Shot.Sequence, MuzzleLocation, MuzzleLocation + (Shot.AimDirection * 10000), SurfaceType_Default);
+		}
+		else
+		{
+			HitScanTraces.AddTrace(Shot.Sequence, MuzzleLocation, TracerEndPoint, SurfaceType);
+		}
+	}
+}
+
+void ASWeapon::FinishShot(uint16 Sequence)
+{
+	const bool bHit = CurrentShot.bPredictedHit;
+	APawn* OwnerPawn = Cast<APawn>(GetOwner());
+
+	if (Role < ROLE_Authority)
+	{
+		// Show the hit marker now and keep the shot until the server says if it really hit
+		CurrentShot.Sequence = Sequence;
+		CurrentShot.FireTime = GetWorld()->TimeSeconds;
+
+		while (PredictedShots.Num() > 0 && (PredictedShots.Num() >= FSShotAckBatch::MaxAcks || CurrentShot.FireTime - PredictedShots[0].FireTime > MaxPredictionAge))
+		{
+			PredictedShots.RemoveAt(0, 1, false);
+		}
+
+		PredictedShots.Add(CurrentShot);
+
+		if (bHit)
+		{
+			OnHitMarker.Broadcast(this, true, false);
+		}
+	}
+	else if (OwnerPawn && !OwnerPawn->IsLocallyControlled())
+	{
+		FSShotAck& Ack = PendingAcks.AddDefaulted_GetRef();
+		Ack.Sequence = Sequence;
+		Ack.bHit = bHit;
+
+		// Sent with the rest of this frames acks
+		SetActorTickEnabled(true);
+	}
+	else if (bHit)
+	{
+		OnHitMarker.Broadcast(this, true, true);
+	}
+
+	CurrentShot.bPredictedHit = false;
+	CurrentShot.HitImpacts.Reset();
+}
+
+void ASWeapon::FlushShotAcks()
+{
+	if (PendingAcks.Num() == 0)
+		return;
+
+	FSShotAckBatch Batch;
+	const int32 NumAcks = FMath::Min(PendingAcks.Num(), FSShotAckBatch::MaxAcks);
+	Batch.Acks.Append(PendingAcks.GetData() + PendingAcks.Num() - NumAcks, NumAcks);
+	PendingAcks.Reset();
+
+	ClientAckShots(Batch);
+
+#if !UE_BUILD_SHIPPING
+	FNetBitWriter Writer(nullptr, 256);
+	bool bSuccess = true;
+	Batch.NetSerialize(Writer, nullptr, bSuccess);
+
+	FSNetStats::RecordRPC(TEXT("SWeapon"), TEXT("ClientAckShots"), Writer.GetNumBits());
+	INC_DWORD_STAT(STAT_ShotAckRPCs);
+	INC_DWORD_STAT_BY(STAT_ShotAckBits, Writer.GetNumBits());
+#endif
+}
+
+void ASWeapon::ClientAckShots_Implementation(const FSShotAckBatch& Batch)
+{
+	for (const FSShotAck& Ack : Batch.Acks)
+	{
+		int32 Index = PredictedShots.IndexOfByPredicate([&Ack](const FSPredictedShot& Predicted)
+		{
+			return Predicted.Sequence == Ack.Sequence;
+		});
+
+		if (Index == INDEX_NONE)
+		{
+			// Too old to roll back, still show the server hit
+			if (Ack.bHit)
 			{
-				RealDamage = CritDamage;
+				OnHitMarker.Broadcast(this, true, true);
 			}
+			continue;
+		}
 
-			UGameplayStatics::ApplyPointDamage(HitActor, RealDamage, ShotDirection, Hit, MyOwner->GetInstigatorController(), this, DamageType);
+		FSPredictedShot& Predicted = PredictedShots[Index];
+		SET_FLOAT_STAT(STAT_ShotAckLatency, (GetWorld()->TimeSeconds - Predicted.FireTime) * 1000.0f);
 
-			PlayImpactFX(SurfaceType, Hit.ImpactPoint);
+		if (Predicted.bPredictedHit && !Ack.bHit)
+		{
+			// Pooled components get reused, only stop the ones still playing our impact
+			for (const TPair<TWeakObjectPtr<UParticleSystemComponent>, FVector>& Impact : Predicted.HitImpacts)
+			{
+				UParticleSystemComponent* ImpactComponent = Impact.Key.Get();
+				if (ImpactComponent && ImpactComponent->IsActive() && ImpactComponent->GetComponentLocation().Equals(Impact.Value, 1.0f))
+				{
+					ImpactComponent->DeactivateImmediate();
+				}
+			}
+
+			INC_DWORD_STAT(STAT_PredictedHitsRolledBack);
+		}
+		else if (!Predicted.bPredictedHit && Ack.bHit)
+		{
+			INC_DWORD_STAT(STAT_HitsMissedByPrediction);
+		}
+
+		if (Predicted.bPredictedHit || Ack.bHit)
+		{
+			OnHitMarker.Broadcast(this, Ack.bHit, true);
+		}
+
+		// Anything older was lost along the way
+		PredictedShots.RemoveAt(0, Index + 1, false);
+	}
+}
+
+void ASWeapon::GetPelletDirections(const FVector& AimDirection, uint16 Seed, TArray<FVector, TInlineAllocator<MaxPellets>>& OutDirections) const
+{
+	const int32 NumPellets = FMath::Clamp(PelletCount, 1, MaxPellets);
+
+	// The server knows the aim from the owners moves, other clients from the replicated aim state
+	float Spread = PelletSpread;
+	ASCharacter* OwnerCharacter = Cast<ASCharacter>(GetOwner());
+	if (OwnerCharacter && OwnerCharacter->IsAiming())
+	{
+		Spread *= AimSpreadMultiplier;
+	}
+
+	if (Spread <= 0.0f)
+	{
+		OutDirections.Init(AimDirection, NumPellets);
+		return;
+	}
+
+	FRandomStream Stream(Seed);
+	const float ConeHalfAngle = FMath::DegreesToRadians(Spread);
+
+	for (int32 i = 0; i < NumPellets; i++)
+	{
+		OutDirections.Add(Stream.VRandCone(AimDirection, ConeHalfAngle));
+	}
+}
 
-			TracerEndPoint = Hit.ImpactPoint;
-		
-			HitScanTrace.SurfaceType = SurfaceType;
+void ASWeapon::PlayPelletFX(const FHitScanTrace& Trace)
+{
+	// The server traced from the eyes, the muzzle is close enough for the effects
+	const FVector TraceFrom = GetMuzzleLocation();
+
+	TArray<FVector, TInlineAllocator<MaxPellets>> PelletDirections;
+	GetPelletDirections(Trace.Direction, Trace.ShotIndex, PelletDirections);
 
-			if (DeubugWeaponDrawing > 0)
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(GetOwner());
+	QueryParams.AddIgnoredActor(this);
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	for (int32 i = 0; i < PelletDirections.Num(); i++)
+	{
+		FVector TraceEnd = TraceFrom + (PelletDirections[i] * 10000);
+
+		// Only for the effects, simple collision is close enough
+		FHitResult Hit;
+		if (GetWorld()->LineTraceSingleByChannel(Hit, TraceFrom, TraceEnd, COLLISION_WEAPON, QueryParams))
+		{
+			PlayImpactFX(UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get()), Hit.ImpactPoint);
+			TraceEnd = Hit.ImpactPoint;
+		}
+
+		if (i == 0)
+		{
+			PlayFireFX(TraceEnd);
+		}
+		else
+		{
+			PlayTracerFX(TraceEnd);
+		}
+	}
+}
+
+void ASWeapon::OnShotTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	for (FSPendingShot& Shot : PendingShots)
+	{
+		if (Shot.TraceHandle == TraceHandle)
+		{
+			Shot.bTraceDone = true;
+
+			if (TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit)
 			{
-				DrawDebugString(GetWorld(), Hit.Location, FString::SanitizeFloat(RealDamage));
-				DrawDebugSphere(GetWorld(), Hit.ImpactPoint, 5.0, 12, FColor::Yellow, 1, 1);
+				Shot.Hit = TraceDatum.OutHits[0];
+				Shot.bBlockingHit = true;
 			}
+			break;
 		}
+	}
 
-		if (DeubugWeaponDrawing > 0)
+	// Every trace of a frame comes back together, resolve them together once they are all in
+	SetActorTickEnabled(true);
+}
+
+void ASWeapon::ResolveShots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponResolveShots);
+
+	int32 NumResolved = 0;
+
+	// Keep the order they were fired in, a shot still waiting holds back the ones after it
+	for (FSPendingShot& Shot : PendingShots)
+	{
+		if (!Shot.bTraceDone)
+			break;
+
+		ApplyShot(Shot);
+		NumResolved++;
+	}
+
+	if (NumResolved > 0)
+	{
+		PendingShots.RemoveAt(0, NumResolved, false);
+	}
+}
+
+void ASWeapon::WakeFromDormancy()
+{
+	LastServerShotTime = GetWorld()->TimeSeconds;
+
+	if (WeaponDormancy <= 0 || NetDormancy == DORM_Awake)
+		return;
+
+	SetNetDormancy(DORM_Awake);
+	GetWorldTimerManager().SetTimer(TimerHandle_Dormancy, this, &ASWeapon::CheckDormancy, DormancyDelay, false);
+}
+
+void ASWeapon::CheckDormancy()
+{
+	float TimeSinceServerShot = GetWorld()->TimeSeconds - LastServerShotTime;
+
+	// Still firing, check again once the delay has passed since the last shot
+	if (TimeSinceServerShot < DormancyDelay)
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_Dormancy, this, &ASWeapon::CheckDormancy, DormancyDelay - TimeSinceServerShot, false);
+		return;
+	}
+
+	SetNetDormancy(DORM_DormantAll);
+}
+
+bool ASWeapon::TraceHitboxes(const FVector& TraceStart, const FVector& TraceEnd, float RewindTime, FHitResult& InOutHit, EPhysicalSurface& OutSurfaceType) const
+{
+	USLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<USLagCompensationSubsystem>();
+	if (!LagCompensation)
+		return false;
+
+	// Anything behind the level hit is blocked
+	FVector HitboxTraceEnd = InOutHit.bBlockingHit ? InOutHit.Location : TraceEnd;
+
+	FHitResult HitboxHit;
+	EPhysicalSurface HitboxSurfaceType = SurfaceType_Default;
+	const bool bHit = RewindTime > 0.0f
+		? LagCompensation->RewindTrace(TraceStart, HitboxTraceEnd, RewindTime, GetOwner(), HitboxHit, HitboxSurfaceType)
+		: LagCompensation->TraceHitboxes(TraceStart, HitboxTraceEnd, GetOwner(), HitboxHit, HitboxSurfaceType);
+
+	if (!bHit)
+		return false;
+
+	InOutHit = HitboxHit;
+	OutSurfaceType = HitboxSurfaceType;
+	return true;
+}
+
+float ASWeapon::GetServerWorldTimeSeconds() const
+{
+	AGameStateBase* GameState = GetWorld()->GetGameState();
+
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+void ASWeapon::OnRep_HitScanTrace()
+{
+	// Several shots can arrive in one update, find every one we have not played yet
+	TArray<const FHitScanTrace*, TInlineAllocator<FHitScanTraceArray::MaxTraces>> NewTraces;
+
+	for (const FHitScanTrace& Trace : HitScanTraces.Items)
+	{
+		if (!bHasPlayedHitScanTrace || (int16)(Trace.ShotIndex - LastPlayedShotIndex) > 0)
 		{
-			DrawDebugLine(GetWorld(), EyeLocation, TraceEnd, FColor::White, false, 1.0f, 0, 1.0f);
+			NewTraces.Add(&Trace);
 		}
+	}
 
-		PlayFireFX(TracerEndPoint);
+	if (NewTraces.Num() == 0)
+		return;
 
-		if (Role == ROLE_Authority)
+	NewTraces.Sort([](const FHitScanTrace& A, const FHitScanTrace& B)
+	{
+		return (int16)(A.ShotIndex - B.ShotIndex) < 0;
+	});
+
+	// When the weapon first becomes relevant only the latest shot is worth showing
+	if (!bHasPlayedHitScanTrace)
+	{
+		NewTraces.RemoveAt(0, NewTraces.Num() - 1);
+	}
+
+	const FVector MuzzleLocation = GetMuzzleLocation();
+
+	for (const FHitScanTrace* Trace : NewTraces)
+	{
+		if (PelletCount > 1)
 		{
-			HitScanTrace.TraceTo = TracerEndPoint;
-			HitScanTrace.SurfaceType = SurfaceType;
+			PlayPelletFX(*Trace);
+			continue;
 		}
 
-		TimeSinceLastShot = GetWorld()->TimeSeconds;
+		const FVector TraceEnd = Trace->GetTraceEnd(MuzzleLocation);
+
+		PlayFireFX(TraceEnd);
+		PlayImpactFX(Trace->SurfaceType, TraceEnd);
 	}
+
+	LastPlayedShotIndex = NewTraces.Last()->ShotIndex;
+	bHasPlayedHitScanTrace = true;
 }
 
-void ASWeapon::OnRep_HitScanTrace()
+bool FHitScanTraceArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
 {
-	PlayFireFX(HitScanTrace.TraceTo);
-	PlayImpactFX(HitScanTrace.SurfaceType, HitScanTrace.TraceTo);
+	const int64 StartBits = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+
+	bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FHitScanTrace, FHitScanTraceArray>(Items, DeltaParms, *this);
+
+	if (DeltaParms.Writer)
+	{
+		const int64 Bits = DeltaParms.Writer->GetNumBits() - StartBits;
+
+		FSNetStats::RecordProperty(TEXT("SWeapon"), TEXT("HitScanTraces"), Bits);
+		INC_DWORD_STAT_BY(STAT_HitScanTracesBits, Bits);
+	}
+
+	return bResult;
 }
 
-void ASWeapon::ServerFire_Implementation()
+void FHitScanTraceArray::AddTrace(uint16 ShotIndex, const FVector& MuzzleLocation, const FVector& TraceEnd, EPhysicalSurface SurfaceType)
 {
-	Fire();
+	if (Items.Num() >= MaxTraces)
+	{
+		Items.RemoveAt(0);
+		MarkArrayDirty();
+	}
+
+	FHitScanTrace& Trace = Items.AddDefaulted_GetRef();
+	Trace.ShotIndex = ShotIndex;
+	Trace.SurfaceType = SurfaceType;
+	FVector Delta = TraceEnd - MuzzleLocation;
+	float Distance = Delta.Size();
+	Trace.Direction = Distance > KINDA_SMALL_NUMBER ? Delta / Distance : FVector::ForwardVector;
+	Trace.Distance = FMath::Min(Distance, FHitScanTrace::MaxDistance);
+
+	MarkItemDirty(Trace);
 }
 
-bool ASWeapon::ServerFire_Validate()
+bool FHitScanTrace::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
 {
+	bOutSuccess = true;
+
+	Ar << ShotIndex;
+
+	uint32 Surface = SurfaceType;
+	Ar.SerializeInt(Surface, SurfaceType_Max);
+
+	const uint32 MaxDirectionValue = (1 << DirectionBits) - 1;
+	const uint32 MaxDistanceValue = (1 << DistanceBits) - 1;
+
+	uint32 U = 0;
+	uint32 V = 0;
+	uint32 QuantizedDistance = 0;
+
+	if (Ar.IsSaving())
+	{
+		// Octahedral encoding, project onto the octahedron and fold the lower half over the upper one
+		FVector Dir = Direction / FMath::Max(FMath::Abs(Direction.X) + FMath::Abs(Direction.Y) + FMath::Abs(Direction.Z), KINDA_SMALL_NUMBER);
+		FVector2D Oct(Dir.X, Dir.Y);
+
+		if (Dir.Z < 0.0f)
+		{
+			Oct.X = (1.0f - FMath::Abs(Dir.Y)) * (Dir.X >= 0.0f ? 1.0f : -1.0f);
+			Oct.Y = (1.0f - FMath::Abs(Dir.X)) * (Dir.Y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		U = (uint32)FMath::Clamp(FMath::RoundToInt((Oct.X * 0.5f + 0.5f) * MaxDirectionValue), 0, (int32)MaxDirectionValue);
+		V = (uint32)FMath::Clamp(FMath::RoundToInt((Oct.Y * 0.5f + 0.5f) * MaxDirectionValue), 0, (int32)MaxDirectionValue);
+		QuantizedDistance = (uint32)FMath::Clamp(FMath::RoundToInt(Distance / MaxDistance * MaxDistanceValue), 0, (int32)MaxDistanceValue);
+	}
+
+	Ar.SerializeInt(U, MaxDirectionValue + 1);
+	Ar.SerializeInt(V, MaxDirectionValue + 1);
+	Ar.SerializeInt(QuantizedDistance, MaxDistanceValue + 1);
+
+	if (Ar.IsLoading())
+	{
+		SurfaceType = (EPhysicalSurface)Surface;
+
+		// Unfold the lower half of the octahedron back out
+		FVector2D Oct(((float)U / MaxDirectionValue) * 2.0f - 1.0f, ((float)V / MaxDirectionValue) * 2.0f - 1.0f);
+		FVector Dir(Oct.X, Oct.Y, 1.0f - FMath::Abs(Oct.X) - FMath::Abs(Oct.Y));
+
+		if (Dir.Z < 0.0f)
+		{
+			Dir.X = (1.0f - FMath::Abs(Oct.Y)) * (Oct.X >= 0.0f ? 1.0f : -1.0f);
+			Dir.Y = (1.0f - FMath::Abs(Oct.X)) * (Oct.Y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		Direction = Dir.GetSafeNormal();
+		Distance = ((float)QuantizedDistance / MaxDistanceValue) * MaxDistance;
+	}
+	else
+	{
+		// Every shot is the same size, compare with HitScanTraces for what the fast array adds on top
+		FSNetStats::RecordProperty(TEXT("SWeapon"), TEXT("HitScanTrace"), 16 + FMath::CeilLogTwo(SurfaceType_Max) + DirectionBits * 2 + DistanceBits);
+	}
+
 	return true;
 }
 
-void ASWeapon::BeginFire()
+FVector ASWeapon::GetMuzzleLocation() const
+{
+	return MeshComponent->GetSocketLocation(MuzzleSocketName);
+}
+
+void ASWeapon::ServerFire_Implementation(FVector_NetQuantize TraceStart, FVector_NetQuantizeNormal ShotDirection, float ClientTimestamp, uint16 ShotSequence)
 {
-	float FirstDelay = FMath::Max(TimeSinceLastShot + TimeBetweenShots - GetWorld()->TimeSeconds, 0.0f);
+#if !UE_BUILD_SHIPPING
+	// Recorded where it arrives, the net stats CSV is only written on the server
+	if (IsRemoteOwnerRPC())
+	{
+		FNetBitWriter Writer(nullptr, 256);
+		bool bSuccess = true;
+		TraceStart.NetSerialize(Writer, nullptr, bSuccess);
+		ShotDirection.NetSerialize(Writer, nullptr, bSuccess);
+		Writer << ClientTimestamp;
+		Writer << ShotSequence;
 
-	GetWorldTimerManager().SetTimer(TimerHandle_TimeBetweenShots, this, &ASWeapon::Fire, TimeBetweenShots, true, FirstDelay);
+		FSNetStats::RecordRPC(TEXT("SWeapon"), TEXT("ServerFire"), Writer.GetNumBits());
+	}
+#endif
+
+	ProcessClientShot(TraceStart, ShotDirection, ClientTimestamp, ShotSequence);
 }
 
-void ASWeapon::EndFire()
+bool ASWeapon::ServerFire_Validate(FVector_NetQuantize TraceStart, FVector_NetQuantizeNormal ShotDirection, float ClientTimestamp, uint16 ShotSequence)
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_TimeBetweenShots);
+	return !TraceStart.ContainsNaN() && !ShotDirection.ContainsNaN() && FMath::IsFinite(ClientTimestamp);
 }
 
-void ASWeapon::PlayFireFX(FVector TracerEndPoint)
+void ASWeapon::ServerFireBatch_Implementation(const FSShotBatch& Batch)
 {
-	if (MuzzleEffect)
+#if !UE_BUILD_SHIPPING
+	if (IsRemoteOwnerRPC())
 	{
-		UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, MeshComponent, MuzzleSocketName);
+		FNetBitWriter Writer(nullptr, 2048);
+		bool bSuccess = true;
+		FSShotBatch ReceivedBatch = Batch;
+		ReceivedBatch.NetSerialize(Writer, nullptr, bSuccess);
+
+		FSNetStats::RecordRPC(TEXT("SWeapon"), TEXT("ServerFireBatch"), Writer.GetNumBits());
 	}
+#endif
 
-	if (TracerEffect)
+	for (const FSShotRecord& Shot : Batch.Shots)
 	{
-		FVector MuzzleLocation = MeshComponent->GetSocketLocation(MuzzleSocketName);
-		UParticleSystemComponent* TracerComponent = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), TracerEffect, MuzzleLocation);
+		ProcessClientShot(Shot.Origin, Shot.AimRotation.Vector(), Shot.Timestamp, Shot.Sequence);
+	}
+}
 
-		if (TracerComponent)
+bool ASWeapon::ServerFireBatch_Validate(const FSShotBatch& Batch)
+{
+	for (const FSShotRecord& Shot : Batch.Shots)
+	{
+		// A NaN or infinite timestamp would poison the rewind time
+		if (Shot.Origin.ContainsNaN() || !FMath::IsFinite(Shot.Timestamp))
+			return false;
+	}
+
+	return Batch.Shots.Num() <= FSShotBatch::MaxShots;
+}
+
+bool ASWeapon::IsRemoteOwnerRPC() const
+{
+	// A listen servers own pawn calls its server RPCs directly, nothing goes over the wire
+	const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	return GetNetMode() != NM_Standalone && !(OwnerPawn && OwnerPawn->IsLocallyControlled());
+}
+
+void ASWeapon::ProcessClientShot(FVector TraceStart, const FVector& ShotDirection, float ClientTimestamp, uint16 ShotSequence)
+{
+	// Shots are resent in the batches after them, only replay the ones we have not seen
+	if (bHasProcessedShot && (int16)(ShotSequence - LastProcessedShotSequence) <= 0)
+	{
+		INC_DWORD_STAT(STAT_DuplicateShotsDropped);
+		return;
+	}
+
+	LastProcessedShotSequence = ShotSequence;
+	bHasProcessedShot = true;
+
+	AActor* MyOwner = GetOwner();
+
+	if (MyOwner)
+	{
+		// Never trust a shot that starts somewhere other than where the server thinks the shooter is
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+		if (FVector::DistSquared(EyeLocation, TraceStart) > FMath::Square(MaxShotOriginError))
 		{
-			TracerComponent->SetVectorParameter("BeamEnd", TracerEndPoint);
+			TraceStart = EyeLocation;
 		}
+
+		float RewindTime = -1.0f;
+
+		USLagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<USLagCompensationSubsystem>();
+		if (LagCompensation && USLagCompensationSubsystem::IsEnabled())
+		{
+			RewindTime = LagCompensation->GetRewindTime(ClientTimestamp);
+		}
+
+		FireShot(TraceStart, ShotDirection, RewindTime, ShotSequence);
+
+		TimeSinceLastShot = GetWorld()->TimeSeconds;
+	}
+}
+
+void ASWeapon::QueueShot(uint16 Sequence, const FVector& Origin, const FRotator& AimRotation, float Timestamp)
+{
+	FSShotRecord Shot;
+	Shot.Sequence = Sequence;
+	Shot.Origin = Origin;
+	Shot.AimRotation = AimRotation;
+	Shot.Timestamp = Timestamp;
+
+	if (ShotHistory.Num() == FSShotBatch::MaxShots)
+	{
+		ShotHistory.RemoveAt(0, 1, false);
 	}
 
+	ShotHistory.Add(Shot);
+	NumUnsentShots = FMath::Min(NumUnsentShots + 1, FSShotBatch::MaxShots);
+
+	// Flush at the end of the frame so every shot fired this frame goes in one batch. Most shots come from the fire
+	// scheduler, which ticks after every actor tick group, so the weapons own tick would send them a frame late
+	if (!PostActorTickHandle.IsValid())
+	{
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ASWeapon::OnWorldPostActorTick);
+	}
+}
+
+void ASWeapon::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld())
+		return;
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PostActorTickHandle.Reset();
+
+	FlushShots();
+}
+
+void ASWeapon::FlushShots()
+{
+	if (NumUnsentShots == 0)
+		return;
+
+	const int32 NumShots = FMath::Min(NumUnsentShots + FMath::Max(ShotRedundancy, 0), ShotHistory.Num());
+
+	FSShotBatch Batch;
+	Batch.Shots.Append(ShotHistory.GetData() + ShotHistory.Num() - NumShots, NumShots);
+
+	ServerFireBatch(Batch);
+	NumUnsentShots = 0;
+
+#if !UE_BUILD_SHIPPING
+	FNetBitWriter Writer(nullptr, 2048);
+	bool bSuccess = true;
+	Batch.NetSerialize(Writer, nullptr, bSuccess);
+
+	INC_DWORD_STAT(STAT_ShotRPCsBatched);
+	INC_DWORD_STAT_BY(STAT_ShotRPCBitsBatched, Writer.GetNumBits());
+#endif
+}
+
+void ASWeapon::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	ResolveShots();
+	FlushShotAcks();
+
+	if (PendingShots.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void ASWeapon::BeginFire()
+{
+	USFireSchedulerSubsystem* FireScheduler = GetWorld()->GetSubsystem<USFireSchedulerSubsystem>();
+	if (FireScheduler)
+	{
+		// Tapping fire can not beat the rate of fire
+		float FirstShotTime = SGameplayRules::GetFirstShotTime(TimeSinceLastShot, TimeBetweenShots, GetWorld()->TimeSeconds);
+		FireScheduler->StartFiring(this, FirstShotTime);
+	}
+}
+
+void ASWeapon::EndFire()
+{
+	USFireSchedulerSubsystem* FireScheduler = GetWorld()->GetSubsystem<USFireSchedulerSubsystem>();
+	if (FireScheduler)
+	{
+		FireScheduler->StopFiring(this);
+	}
+}
+
+void ASWeapon::ResetForPool()
+{
+	EndFire();
+
+	// Shots still waiting on their trace belong to the last owner
+	PendingShots.Reset();
+	PredictedShots.Reset();
+	PendingAcks.Reset();
+	ShotHistory.Reset();
+	NumUnsentShots = 0;
+
+	// The next owner starts counting shots from zero, the server must not drop them as duplicates of the last owners
+	NextShotSequence = 0;
+	LastProcessedShotSequence = 0;
+	bHasProcessedShot = false;
+	TimeSinceLastShot = -BIG_NUMBER;
+
+	SetActorTickEnabled(false);
+
+	// Nothing will check on it while it is pooled, so go back to sleep now
+	GetWorldTimerManager().ClearTimer(TimerHandle_Dormancy);
+	if (Role == ROLE_Authority && WeaponDormancy > 0)
+	{
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void ASWeapon::PlayFireFX(FVector TracerEndPoint)
+{
+	USParticlePoolSubsystem* ParticlePool = GetWorld()->GetSubsystem<USParticlePoolSubsystem>();
+
+	if (MuzzleEffect.Get() && ParticlePool)
+	{
+		ParticlePool->SpawnEmitterAttached(MuzzleEffect.Get(), MeshComponent, MuzzleSocketName);
+	}
+
+	PlayTracerFX(TracerEndPoint);
+
 	AActor* MyOwner = Cast<APawn>(GetOwner());
 
-	if (MyOwner)
+	if (MyOwner && FireCamShake.Get())
 	{
 		APlayerController* PC = Cast<APlayerController>(MyOwner->GetInstigatorController());
 
-		if (PC)
+		// The owning client plays its own shake when it fires, the server never sends one
+		if (PC && PC->IsLocalController() && PC->PlayerCameraManager)
 		{
-			PC->ClientPlayCameraShake(FireCamShake);
+			PC->PlayerCameraManager->PlayCameraShake(FireCamShake.Get(), 1.0f);
 		}
 	}
 }
 
-void ASWeapon::PlayImpactFX(EPhysicalSurface SurfaceType, FVector ImpactPoint)
+void ASWeapon::PlayTracerFX(FVector TracerEndPoint)
+{
+	USParticlePoolSubsystem* ParticlePool = GetWorld()->GetSubsystem<USParticlePoolSubsystem>();
+
+	if (TracerEffect.Get() && ParticlePool)
+	{
+		FVector MuzzleLocation = MeshComponent->GetSocketLocation(MuzzleSocketName);
+		UParticleSystemComponent* TracerComponent = ParticlePool->SpawnEmitterAtLocation(TracerEffect.Get(), MuzzleLocation);
+
+		if (TracerComponent)
+		{
+			TracerComponent->SetVectorParameter("BeamEnd", TracerEndPoint);
+		}
+	}
+}
+
+UParticleSystemComponent* ASWeapon::PlayImpactFX(EPhysicalSurface SurfaceType, FVector ImpactPoint)
 {
 	UParticleSystem* SelectedEffect = nullptr;
 
@@ -195,27 +1081,31 @@ void ASWeapon::PlayImpactFX(EPhysicalSurface SurfaceType, FVector ImpactPoint)
 	{
 	case SURFACE_FLESHDEFAULT:
 	case SURFACE_FLESHVULNERABLE:
-		SelectedEffect = FleshImpactEffect;
+		SelectedEffect = FleshImpactEffect.Get();
 		break;
 	default:
-		SelectedEffect = DefaultImpactEffect;
+		SelectedEffect = DefaultImpactEffect.Get();
 		break;
 	}
 
-	if (SelectedEffect)
+	USParticlePoolSubsystem* ParticlePool = GetWorld()->GetSubsystem<USParticlePoolSubsystem>();
+
+	if (SelectedEffect && ParticlePool)
 	{
 		FVector MuzzleLocation = MeshComponent->GetSocketLocation(MuzzleSocketName);
 		FVector ShotDirection = ImpactPoint - MuzzleLocation;
 		ShotDirection.Normalize();
 
 		// Add the muzzle hit effect
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), SelectedEffect, ImpactPoint, ShotDirection.Rotation());
+		return ParticlePool->SpawnEmitterAtLocation(SelectedEffect, ImpactPoint, ShotDirection.Rotation());
 	}
+
+	return nullptr;
 }
 
 void ASWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(ASWeapon, HitScanTrace, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(ASWeapon, HitScanTraces, COND_SkipOwner);
 }
\ No newline at end of file
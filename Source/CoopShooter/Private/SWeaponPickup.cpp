@@ -2,12 +2,23 @@
 
 
 #include "SWeaponPickup.h"
+#include "SCharacter.h"
+#include "SWeapon.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/SInventoryComponent.h"
+#include "Subsystems/SAssetStreamingSubsystem.h"
+#include "Subsystems/SPickupSubsystem.h"
+#include "Engine/World.h"
 
 // Sets default values
 ASWeaponPickup::ASWeaponPickup()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// The pickup subsystem does everything a pickup would have ticked for
+	PrimaryActorTick.bCanEverTick = false;
+
+	// A pickup never changes once dropped, replicate it once and then leave it dormant
+	SetReplicates(true);
+	NetDormancy = DORM_Initial;
 
 }
 
@@ -15,13 +26,61 @@ ASWeaponPickup::ASWeaponPickup()
 void ASWeaponPickup::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// Players are found by the pickup subsystem, not by overlaps
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(this);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		Primitive->SetGenerateOverlapEvents(false);
+	}
+
+	if (Role == ROLE_Authority)
+	{
+		USAssetStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<USAssetStreamingSubsystem>();
+		if (Streaming)
+		{
+			Streaming->RequestLoad({ WeaponClass.ToSoftObjectPath() }, false);
+		}
+
+		USPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<USPickupSubsystem>();
+		if (PickupSubsystem)
+		{
+			PickupSubsystem->RegisterPickup(this);
+		}
+	}
 }
 
-// Called every frame
-void ASWeaponPickup::Tick(float DeltaTime)
+void ASWeaponPickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	USPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<USPickupSubsystem>();
+	if (PickupSubsystem)
+	{
+		PickupSubsystem->UnregisterPickup(this);
+	}
 
+	Super::EndPlay(EndPlayReason);
 }
 
+bool ASWeaponPickup::GiveTo(ASCharacter* Character)
+{
+	// Still streaming in, try again next time
+	TSubclassOf<ASWeapon> Weapon = WeaponClass.Get();
+	if (!Weapon || !Character)
+		return false;
+
+	USInventoryComponent* Inventory = Character->GetInventoryComponent();
+	if (!Inventory || Inventory->HasWeapon(Weapon))
+		return false;
+
+	int32 Slot = Inventory->AddWeapon(Weapon);
+	if (Slot == INDEX_NONE)
+		return false;
+
+	// Empty handed characters take it straight away
+	if (!Inventory->GetEquippedWeapon())
+	{
+		Inventory->EquipWeapon(Slot);
+	}
+
+	return true;
+}
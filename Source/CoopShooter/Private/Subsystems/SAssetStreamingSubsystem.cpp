@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SAssetStreamingSubsystem.h"
+#include "Engine/World.h"
+#include "CoopShooter.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Streamed Assets"), STAT_AssetStreamingAssets, STATGROUP_CoopShooter);
+
+void USAssetStreamingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	if (!World || !World->IsGameWorld())
+		return;
+
+	const FName MapName = *UWorld::RemovePIEPrefix(World->GetMapName());
+	const FSPreloadManifest* Manifest = MapManifests.Find(MapName);
+	if (!Manifest)
+		return;
+
+	TArray<FSoftObjectPath> Assets = Manifest->GameplayAssets;
+	if (ShouldLoadCosmetics())
+	{
+		Assets.Append(Manifest->CosmeticAssets);
+	}
+
+	PreloadStartTime = FPlatformTime::Seconds();
+	RequestLoad(Assets, false, FStreamableDelegate::CreateUObject(this, &USAssetStreamingSubsystem::OnPreloadComplete));
+}
+
+void USAssetStreamingSubsystem::Deinitialize()
+{
+	// Assets loaded together share a handle, releasing it again does nothing
+	for (TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Handle : Handles)
+	{
+		Handle.Value->ReleaseHandle();
+	}
+
+	Handles.Empty();
+	SET_DWORD_STAT(STAT_AssetStreamingAssets, 0);
+
+	Super::Deinitialize();
+}
+
+void USAssetStreamingSubsystem::RequestLoad(const TArray<FSoftObjectPath>& Assets, bool bCosmetic, FStreamableDelegate OnLoaded)
+{
+	if (bCosmetic && !ShouldLoadCosmetics())
+		return;
+
+	TArray<FSoftObjectPath> AssetsToLoad;
+	bool bAllResident = true;
+
+	for (const FSoftObjectPath& Asset : Assets)
+	{
+		if (Asset.IsNull())
+			continue;
+
+		AssetsToLoad.AddUnique(Asset);
+		bAllResident &= Handles.Contains(Asset) && Asset.ResolveObject() != nullptr;
+	}
+
+	// Nothing to wait for, don't make a handle just to call back
+	if (bAllResident)
+	{
+		OnLoaded.ExecuteIfBound();
+		return;
+	}
+
+	// The manager holds on to the handle until it has loaded, so OnLoaded is called even if it is not kept below
+	TSharedPtr<FStreamableHandle> Handle = StreamableManager.RequestAsyncLoad(AssetsToLoad, OnLoaded, FStreamableManager::AsyncLoadHighPriority);
+	if (!Handle.IsValid())
+		return;
+
+	// One handle per asset keeps it resident, asking for an asset again does not add another
+	for (const FSoftObjectPath& Asset : AssetsToLoad)
+	{
+		if (!Handles.Contains(Asset))
+		{
+			Handles.Add(Asset, Handle);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_AssetStreamingAssets, Handles.Num());
+}
+
+bool USAssetStreamingSubsystem::ShouldLoadCosmetics() const
+{
+	UWorld* World = GetWorld();
+
+	return !IsRunningDedicatedServer() && (!World || World->GetNetMode() != NM_DedicatedServer);
+}
+
+void USAssetStreamingSubsystem::OnPreloadComplete()
+{
+	UE_LOG(LogTemp, Log, TEXT("Preloaded the manifest for %s in %.2f seconds"), *GetWorld()->GetMapName(), FPlatformTime::Seconds() - PreloadStartTime);
+}
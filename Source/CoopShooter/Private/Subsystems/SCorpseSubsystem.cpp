@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SCorpseSubsystem.h"
+#include "SCharacter.h"
+#include "CoopShooter.h"
+#include "Engine/World.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Corpse Tick"), STAT_CorpseTick, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Simulating Ragdolls"), STAT_SimulatingRagdolls, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Frozen Corpses"), STAT_FrozenCorpses, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ragdoll Physics Bodies"), STAT_RagdollPhysicsBodies, STATGROUP_CoopShooter);
+
+static int32 MaxSimulatingRagdolls = 8;
+FAutoConsoleVariableRef CVARMaxSimulatingRagdolls(
+	TEXT("COOP.Corpses.MaxRagdolls"),
+	MaxSimulatingRagdolls,
+	TEXT("The most ragdolls a client simulates at once, the oldest are frozen past this"),
+	ECVF_Scalability);
+
+static float MinRagdollSeconds = 0.5f;
+FAutoConsoleVariableRef CVARMinRagdollSeconds(
+	TEXT("COOP.Corpses.MinRagdollSeconds"),
+	MinRagdollSeconds,
+	TEXT("How long a ragdoll simulates before it can be frozen for coming to rest, so it falls over first"),
+	ECVF_Scalability);
+
+static float MaxRagdollSeconds = 5.0f;
+FAutoConsoleVariableRef CVARMaxRagdollSeconds(
+	TEXT("COOP.Corpses.MaxRagdollSeconds"),
+	MaxRagdollSeconds,
+	TEXT("How long a ragdoll simulates before it is frozen even if it has not come to rest"),
+	ECVF_Scalability);
+
+static int32 MaxCorpses = 16;
+FAutoConsoleVariableRef CVARMaxCorpses(
+	TEXT("COOP.Corpses.Max"),
+	MaxCorpses,
+	TEXT("The most corpses the server keeps, the oldest are destroyed past this"),
+	ECVF_Default);
+
+static float CorpseLifetime = 30.0f;
+FAutoConsoleVariableRef CVARCorpseLifetime(
+	TEXT("COOP.Corpses.Lifetime"),
+	CorpseLifetime,
+	TEXT("Seconds the server keeps a corpse before destroying it, 0 keeps them until the cap is reached"),
+	ECVF_Default);
+
+/** Below this speed a ragdoll is treated as at rest */
+static const float RagdollRestSpeed = 5.0f;
+
+void USCorpseSubsystem::Deinitialize()
+{
+	Corpses.Empty();
+
+	Super::Deinitialize();
+}
+
+void USCorpseSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CorpseTick);
+
+	const float TimeSeconds = GetWorld()->TimeSeconds;
+	const bool bAuthority = GetWorld()->GetNetMode() != NM_Client;
+
+	int32 NumSimulating = 0;
+	int32 NumFrozen = 0;
+	int32 NumBodies = 0;
+
+	for (int32 i = Corpses.Num() - 1; i >= 0; i--)
+	{
+		FSCorpse& Corpse = Corpses[i];
+
+		if (!Corpse.Character || Corpse.Character->IsPendingKill())
+		{
+			Corpses.RemoveAt(i);
+			continue;
+		}
+
+		if (bAuthority && CorpseLifetime > 0.0f && TimeSeconds - Corpse.DeathTime > CorpseLifetime)
+		{
+			// Remove first, destroying calls back into RemoveCorpse
+			ASCharacter* Character = Corpse.Character;
+			Corpses.RemoveAt(i);
+			Character->Destroy();
+			continue;
+		}
+
+		if (Corpse.bSimulating)
+		{
+			USkeletalMeshComponent* Mesh = Corpse.Character->GetMesh();
+			const float RagdollSeconds = TimeSeconds - Corpse.DeathTime;
+
+			// The root body starts out still, give it time to fall before it counts as at rest
+			bool bAtRest = RagdollSeconds >= MinRagdollSeconds && Mesh->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(RagdollRestSpeed);
+
+			if (bAtRest || RagdollSeconds > MaxRagdollSeconds)
+			{
+				FreezeRagdoll(Corpse);
+			}
+			else
+			{
+				NumSimulating++;
+				NumBodies += Mesh->Bodies.Num();
+			}
+		}
+
+		if (Corpse.bFrozen)
+		{
+			NumFrozen++;
+		}
+	}
+
+	// Too many bodies lying around, the oldest go first
+	if (bAuthority && MaxCorpses > 0)
+	{
+		while (Corpses.Num() > MaxCorpses)
+		{
+			ASCharacter* Character = Corpses[0].Character;
+			Corpses.RemoveAt(0);
+
+			if (Character)
+			{
+				Character->Destroy();
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SimulatingRagdolls, NumSimulating);
+	SET_DWORD_STAT(STAT_FrozenCorpses, NumFrozen);
+	SET_DWORD_STAT(STAT_RagdollPhysicsBodies, NumBodies);
+}
+
+bool USCorpseSubsystem::IsTickable() const
+{
+	return Corpses.Num() > 0 && !IsTemplate();
+}
+
+UWorld* USCorpseSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USCorpseSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USCorpseSubsystem, STATGROUP_Tickables);
+}
+
+void USCorpseSubsystem::AddCorpse(ASCharacter* Character)
+{
+	if (!Character || Corpses.ContainsByPredicate([Character](const FSCorpse& Corpse) { return Corpse.Character == Character; }))
+		return;
+
+	FSCorpse& Corpse = Corpses.AddDefaulted_GetRef();
+	Corpse.Character = Character;
+	Corpse.DeathTime = GetWorld()->TimeSeconds;
+
+	if (ShouldSimulateRagdolls())
+	{
+		StartRagdoll(Corpse);
+		EnforceRagdollCap();
+	}
+	else
+	{
+		// The server only needs the body where it fell, nothing collides with it or animates it
+		USkeletalMeshComponent* Mesh = Character->GetMesh();
+		Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Mesh->SetComponentTickEnabled(false);
+	}
+}
+
+void USCorpseSubsystem::RemoveCorpse(ASCharacter* Character)
+{
+	Corpses.RemoveAll([Character](const FSCorpse& Corpse)
+	{
+		return Corpse.Character == Character;
+	});
+}
+
+int32 USCorpseSubsystem::GetNumSimulatingRagdolls() const
+{
+	int32 NumSimulating = 0;
+
+	for (const FSCorpse& Corpse : Corpses)
+	{
+		if (Corpse.bSimulating)
+		{
+			NumSimulating++;
+		}
+	}
+
+	return NumSimulating;
+}
+
+bool USCorpseSubsystem::ShouldSimulateRagdolls() const
+{
+	// Ragdolls are purely cosmetic, a listen server simulates them for its own player
+	return GetWorld()->GetNetMode() != NM_DedicatedServer && MaxSimulatingRagdolls > 0;
+}
+
+void USCorpseSubsystem::StartRagdoll(FSCorpse& Corpse)
+{
+	USkeletalMeshComponent* Mesh = Corpse.Character->GetMesh();
+
+	Mesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	Mesh->SetAllBodiesSimulatePhysics(true);
+	Mesh->WakeAllRigidBodies();
+	Mesh->bBlendPhysics = true;
+
+	Corpse.bSimulating = true;
+}
+
+void USCorpseSubsystem::FreezeRagdoll(FSCorpse& Corpse)
+{
+	USkeletalMeshComponent* Mesh = Corpse.Character->GetMesh();
+
+	// Without its tick the mesh keeps the last pose it had, so the bodies can be removed without it snapping back
+	Mesh->SetComponentTickEnabled(false);
+	Mesh->SetAllBodiesSimulatePhysics(false);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	Corpse.bSimulating = false;
+	Corpse.bFrozen = true;
+}
+
+void USCorpseSubsystem::EnforceRagdollCap()
+{
+	int32 NumToFreeze = GetNumSimulatingRagdolls() - MaxSimulatingRagdolls;
+
+	for (int32 i = 0; i < Corpses.Num() && NumToFreeze > 0; i++)
+	{
+		if (Corpses[i].bSimulating && Corpses[i].Character)
+		{
+			FreezeRagdoll(Corpses[i]);
+			NumToFreeze--;
+		}
+	}
+}
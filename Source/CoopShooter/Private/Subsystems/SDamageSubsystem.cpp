@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SDamageSubsystem.h"
+#include "Components/SHealthComponent.h"
+#include "CoopShooter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/DamageType.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Queue Resolve"), STAT_DamageQueueResolve, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued Damage Events"), STAT_QueuedDamageEvents, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued Vulnerable Hits"), STAT_QueuedVulnerableHits, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damaged Targets"), STAT_DamagedTargets, STATGROUP_CoopShooter);
+
+static int32 DamageQueue = 1;
+FAutoConsoleVariableRef CVARDamageQueue(
+	TEXT("COOP.DamageQueue"),
+	DamageQueue,
+	TEXT("Queue weapon damage and apply it once a frame, 0 applies every hit through ApplyPointDamage"),
+	ECVF_Default);
+
+/** Hit every health component in the world NumHits times through both paths, the damage is tiny so nobody dies */
+static FAutoConsoleCommandWithWorldAndArgs DamageBenchmarkCommand(
+	TEXT("COOP.DamageQueue.Benchmark"),
+	TEXT("Apply <NumHits, default 1000> tiny hits spread over the health components in the world through ApplyDamage and through the damage queue, and log how long each took. Server only"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USDamageSubsystem* DamageSubsystem = World ? World->GetSubsystem<USDamageSubsystem>() : nullptr;
+		if (!DamageSubsystem || World->GetNetMode() == NM_Client)
+			return;
+
+		TArray<USHealthComponent*> HealthComponents;
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			USHealthComponent* HealthComponent = It->FindComponentByClass<USHealthComponent>();
+			if (HealthComponent && HealthComponent->GetHealth() > 0.0f)
+			{
+				HealthComponents.Add(HealthComponent);
+			}
+		}
+
+		if (HealthComponents.Num() == 0)
+			return;
+
+		const int32 NumHits = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+		const float Damage = 0.001f;
+		const float TimeSeconds = World->TimeSeconds;
+
+		// Anything already queued belongs to the game, not the benchmark
+		DamageSubsystem->ResolveDamage();
+
+		double DirectSeconds = 0.0;
+		{
+			FScopedDurationTimer Timer(DirectSeconds);
+			for (int32 i = 0; i < NumHits; i++)
+			{
+				AActor* Target = HealthComponents[i % HealthComponents.Num()]->GetOwner();
+				UGameplayStatics::ApplyDamage(Target, Damage, nullptr, nullptr, UDamageType::StaticClass());
+			}
+		}
+
+		double QueuedSeconds = 0.0;
+		{
+			FScopedDurationTimer Timer(QueuedSeconds);
+			for (int32 i = 0; i < NumHits; i++)
+			{
+				AActor* Target = HealthComponents[i % HealthComponents.Num()]->GetOwner();
+				DamageSubsystem->QueueDamage(Target, Damage, SurfaceType_Default, nullptr, nullptr, UDamageType::StaticClass(), TimeSeconds);
+			}
+
+			DamageSubsystem->ResolveDamage();
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("Damage benchmark, %d hits on %d targets: ApplyDamage %.3f ms, damage queue %.3f ms"),
+			NumHits, HealthComponents.Num(), DirectSeconds * 1000.0, QueuedSeconds * 1000.0);
+	}));
+
+void FSDamageQueue::Reset()
+{
+	Targets.Reset();
+	Amounts.Reset();
+	SurfaceTypes.Reset();
+	Instigators.Reset();
+	DamageCausers.Reset();
+	DamageTypes.Reset();
+	Timestamps.Reset();
+}
+
+void FSDamageQueue::RemoveFirst(int32 Count)
+{
+	if (Count >= Num())
+	{
+		Reset();
+		return;
+	}
+
+	Targets.RemoveAt(0, Count, false);
+	Amounts.RemoveAt(0, Count, false);
+	SurfaceTypes.RemoveAt(0, Count, false);
+	Instigators.RemoveAt(0, Count, false);
+	DamageCausers.RemoveAt(0, Count, false);
+	DamageTypes.RemoveAt(0, Count, false);
+	Timestamps.RemoveAt(0, Count, false);
+}
+
+void USDamageSubsystem::Deinitialize()
+{
+	Queue.Reset();
+
+	Super::Deinitialize();
+}
+
+void USDamageSubsystem::Tick(float DeltaTime)
+{
+	ResolveDamage();
+}
+
+bool USDamageSubsystem::IsTickable() const
+{
+	return Queue.Num() > 0 && !IsTemplate();
+}
+
+UWorld* USDamageSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USDamageSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USDamageSubsystem, STATGROUP_Tickables);
+}
+
+bool USDamageSubsystem::QueueDamage(AActor* Target, float Amount, EPhysicalSurface SurfaceType, AController* Instigator, AActor* DamageCauser, TSubclassOf<UDamageType> DamageType, float Timestamp)
+{
+	if (!IsEnabled() || !Target || !Target->HasAuthority())
+		return false;
+
+	USHealthComponent* HealthComponent = Target->FindComponentByClass<USHealthComponent>();
+	if (!HealthComponent)
+		return false;
+
+	// Handled here, as the damage would have been rejected by TakeDamage
+	if (!Target->bCanBeDamaged || Amount <= 0.0f)
+		return true;
+
+	Queue.Targets.Add(HealthComponent);
+	Queue.Amounts.Add(Amount);
+	Queue.SurfaceTypes.Add(SurfaceType);
+	Queue.Instigators.Add(Instigator);
+	Queue.DamageCausers.Add(DamageCauser);
+	Queue.DamageTypes.Add(DamageType);
+	Queue.Timestamps.Add(Timestamp);
+
+	return true;
+}
+
+void USDamageSubsystem::ResolveDamage()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DamageQueueResolve);
+
+	const int32 NumEvents = Queue.Num();
+	if (NumEvents == 0)
+		return;
+
+	// Events are applied in the order they happened, so the hit that actually kills gets the credit
+	SortedEvents.Reset();
+	for (int32 i = 0; i < NumEvents; i++)
+	{
+		SortedEvents.Add(i);
+	}
+
+	const TArray<float>& Timestamps = Queue.Timestamps;
+	SortedEvents.StableSort([&Timestamps](int32 A, int32 B) { return Timestamps[A] < Timestamps[B]; });
+
+	ResolvedTargets.Reset();
+	TargetSlots.Reset();
+
+	int32 NumVulnerableHits = 0;
+
+	for (int32 Event : SortedEvents)
+	{
+		USHealthComponent* HealthComponent = Queue.Targets[Event].Get();
+		if (!HealthComponent)
+			continue;
+
+		int32 Slot;
+		if (int32* ExistingSlot = TargetSlots.Find(HealthComponent))
+		{
+			Slot = *ExistingSlot;
+		}
+		else
+		{
+			Slot = ResolvedTargets.Num();
+			TargetSlots.Add(HealthComponent, Slot);
+			ResolvedTargets.Add({ HealthComponent, HealthComponent->GetHealth(), 0.0f, INDEX_NONE });
+		}
+
+		// Damage after the killing hit is dropped
+		FSResolvedDamage& Resolved = ResolvedTargets[Slot];
+		if (Resolved.Health - Resolved.Damage <= 0.0f)
+			continue;
+
+		Resolved.Damage += Queue.Amounts[Event];
+		Resolved.LastEvent = Event;
+
+		if (Queue.SurfaceTypes[Event] == SURFACE_FLESHVULNERABLE)
+		{
+			NumVulnerableHits++;
+		}
+	}
+
+	for (const FSResolvedDamage& Resolved : ResolvedTargets)
+	{
+		if (Resolved.LastEvent == INDEX_NONE)
+			continue;
+
+		const TSubclassOf<UDamageType> DamageType = Queue.DamageTypes[Resolved.LastEvent];
+		const UDamageType* DamageTypeCDO = DamageType ? DamageType->GetDefaultObject<UDamageType>() : GetDefault<UDamageType>();
+
+		Resolved.Target->ApplyDamage(Resolved.Damage, DamageTypeCDO, Queue.Instigators[Resolved.LastEvent].Get(), Queue.DamageCausers[Resolved.LastEvent].Get());
+	}
+
+	// Anything queued while the damage was applied waits for the next frame
+	Queue.RemoveFirst(NumEvents);
+
+	INC_DWORD_STAT_BY(STAT_QueuedDamageEvents, NumEvents);
+	INC_DWORD_STAT_BY(STAT_QueuedVulnerableHits, NumVulnerableHits);
+	INC_DWORD_STAT_BY(STAT_DamagedTargets, ResolvedTargets.Num());
+}
+
+bool USDamageSubsystem::IsEnabled()
+{
+	return DamageQueue > 0;
+}
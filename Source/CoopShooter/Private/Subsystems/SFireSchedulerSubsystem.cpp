@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SFireSchedulerSubsystem.h"
+#include "SWeapon.h"
+#include "CoopShooter.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Fire Scheduler Tick"), STAT_FireSchedulerTick, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Firing Weapons"), STAT_FiringWeapons, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduled Shots"), STAT_ScheduledShots, STATGROUP_CoopShooter);
+
+/** After a hitch only this much time is caught up on, so a long frame does not dump a whole magazine at once */
+static const float MaxCatchUpTime = 0.25f;
+
+void USFireSchedulerSubsystem::Deinitialize()
+{
+	FiringWeapons.Empty();
+
+	Super::Deinitialize();
+}
+
+void USFireSchedulerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FireSchedulerTick);
+
+	const float TimeSeconds = GetWorld()->TimeSeconds;
+	const float FrameStartTime = TimeSeconds - DeltaTime;
+
+	int32 NumShots = 0;
+
+	// Weapons can start or stop firing from inside Fire, which can grow the array, so always index back into it
+	for (int32 i = 0; i < FiringWeapons.Num(); i++)
+	{
+		ASWeapon* Weapon = FiringWeapons[i].Weapon;
+		if (FiringWeapons[i].bStopped || !Weapon || Weapon->IsPendingKill())
+			continue;
+
+		AActor* MyOwner = Weapon->GetOwner();
+		if (!MyOwner)
+			continue;
+
+		// A weapon without a rate of fire cannot fire, clamping it would empty the catch up window in one frame
+		const float TimeBetweenShots = Weapon->GetTimeBetweenShots();
+		if (TimeBetweenShots <= 0.0f)
+		{
+			FiringWeapons[i].bStopped = true;
+			continue;
+		}
+
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+		if (!FiringWeapons[i].bHasLastAim)
+		{
+			FiringWeapons[i].LastEyeLocation = EyeLocation;
+			FiringWeapons[i].LastEyeRotation = EyeRotation;
+			FiringWeapons[i].bHasLastAim = true;
+		}
+
+		FiringWeapons[i].NextShotTime = FMath::Max(FiringWeapons[i].NextShotTime, TimeSeconds - MaxCatchUpTime);
+
+		const FVector LastEyeLocation = FiringWeapons[i].LastEyeLocation;
+		const FRotator LastEyeRotation = FiringWeapons[i].LastEyeRotation;
+
+		while (!FiringWeapons[i].bStopped && !Weapon->IsPendingKill() && FiringWeapons[i].NextShotTime <= TimeSeconds)
+		{
+			const float ShotTime = FiringWeapons[i].NextShotTime;
+			FiringWeapons[i].NextShotTime += TimeBetweenShots;
+
+			// Where the owner was aiming at the moment the shot was due
+			const float Alpha = DeltaTime > 0.0f ? FMath::Clamp((ShotTime - FrameStartTime) / DeltaTime, 0.0f, 1.0f) : 1.0f;
+			const FVector ShotLocation = FMath::Lerp(LastEyeLocation, EyeLocation, Alpha);
+			const FRotator ShotRotation = FMath::Lerp(LastEyeRotation, EyeRotation, Alpha);
+
+			Weapon->Fire(ShotLocation, ShotRotation, TimeSeconds - ShotTime);
+			NumShots++;
+		}
+
+		FiringWeapons[i].LastEyeLocation = EyeLocation;
+		FiringWeapons[i].LastEyeRotation = EyeRotation;
+	}
+
+	FiringWeapons.RemoveAll([](const FSScheduledWeapon& Scheduled)
+	{
+		return Scheduled.bStopped || !Scheduled.Weapon || Scheduled.Weapon->IsPendingKill();
+	});
+
+	INC_DWORD_STAT_BY(STAT_ScheduledShots, NumShots);
+	SET_DWORD_STAT(STAT_FiringWeapons, FiringWeapons.Num());
+}
+
+bool USFireSchedulerSubsystem::IsTickable() const
+{
+	return FiringWeapons.Num() > 0 && !IsTemplate();
+}
+
+UWorld* USFireSchedulerSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USFireSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USFireSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+void USFireSchedulerSubsystem::StartFiring(ASWeapon* Weapon, float FirstShotTime)
+{
+	if (!Weapon || Weapon->GetTimeBetweenShots() <= 0.0f)
+		return;
+
+	FSScheduledWeapon* Scheduled = FiringWeapons.FindByPredicate([Weapon](const FSScheduledWeapon& Entry) { return Entry.Weapon == Weapon; });
+
+	if (!Scheduled)
+	{
+		Scheduled = &FiringWeapons.AddDefaulted_GetRef();
+		Scheduled->Weapon = Weapon;
+	}
+	else if (!Scheduled->bStopped)
+	{
+		// Already firing, keep the current cadence
+		return;
+	}
+
+	Scheduled->NextShotTime = FirstShotTime;
+	Scheduled->bHasLastAim = false;
+	Scheduled->bStopped = false;
+}
+
+void USFireSchedulerSubsystem::StopFiring(ASWeapon* Weapon)
+{
+	for (FSScheduledWeapon& Scheduled : FiringWeapons)
+	{
+		if (Scheduled.Weapon == Weapon)
+		{
+			Scheduled.bStopped = true;
+		}
+	}
+}
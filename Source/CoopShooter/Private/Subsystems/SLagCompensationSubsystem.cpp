@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SLagCompensationSubsystem.h"
+#include "Components/SLagCompensationComponent.h"
+#include "SCharacter.h"
+#include "Engine/World.h"
+#include "CoopShooter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Rewind Trace"), STAT_LagCompensationRewindTrace, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound Shots"), STAT_LagCompensationRewoundShots, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound Actors Tested"), STAT_LagCompensationActorsTested, STATGROUP_CoopShooter);
+DECLARE_CYCLE_STAT(TEXT("Hitbox Broadphase Update"), STAT_HitboxBroadphaseUpdate, STATGROUP_CoopShooter);
+DECLARE_CYCLE_STAT(TEXT("Hitbox Broadphase Trace"), STAT_HitboxBroadphaseTrace, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitbox Broadphase Traces"), STAT_HitboxBroadphaseTraces, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitbox Broadphase Actors Tested"), STAT_HitboxBroadphaseActorsTested, STATGROUP_CoopShooter);
+
+static int32 LagCompensationEnabled = 1;
+FAutoConsoleVariableRef CVARLagCompensationEnabled(
+	TEXT("COOP.LagCompensation"),
+	LagCompensationEnabled,
+	TEXT("Rewind hitboxes to the client fire time when the server processes a shot"),
+	ECVF_Cheat);
+
+static float LagCompensationMaxRewindMs = 250.0f;
+FAutoConsoleVariableRef CVARLagCompensationMaxRewindMs(
+	TEXT("COOP.LagCompensation.MaxRewindMs"),
+	LagCompensationMaxRewindMs,
+	TEXT("The furthest back in time a shot can be rewound, in milliseconds"),
+	ECVF_Default);
+
+static int32 HitboxBroadphase = 1;
+FAutoConsoleVariableRef CVARHitboxBroadphase(
+	TEXT("COOP.HitboxBroadphase"),
+	HitboxBroadphase,
+	TEXT("Trace shots against the world with simple collision and against characters with the hitboxes, 0 traces complex collision for both"),
+	ECVF_Default);
+
+void FSHitboxBroadphase::Reset()
+{
+	Components.Reset();
+	Owners.Reset();
+	BoundsCenters.Reset();
+	BoundsRadii.Reset();
+	FirstHitboxes.Reset();
+	NumHitboxes.Reset();
+	Starts.Reset();
+	Ends.Reset();
+	Radii.Reset();
+	SurfaceTypes.Reset();
+}
+
+void USLagCompensationSubsystem::RegisterComponent(USLagCompensationComponent* Component)
+{
+	Components.AddUnique(Component);
+}
+
+void USLagCompensationSubsystem::UnregisterComponent(USLagCompensationComponent* Component)
+{
+	Components.RemoveSwap(Component);
+
+	// The packed arrays point at the component, rebuild them
+	Broadphase.BuiltFrame = MAX_uint64;
+}
+
+float USLagCompensationSubsystem::GetRewindTime(float ClientTimestamp) const
+{
+	const float ServerTime = GetWorld()->GetTimeSeconds();
+	const float MaxRewind = FMath::Max(LagCompensationMaxRewindMs, 0.0f) / 1000.0f;
+
+	return FMath::Clamp(ClientTimestamp, ServerTime - MaxRewind, ServerTime);
+}
+
+bool USLagCompensationSubsystem::RewindTrace(const FVector& TraceStart, const FVector& TraceEnd, float Time, const AActor* IgnoredActor, FHitResult& OutHit, EPhysicalSurface& OutSurfaceType) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRewindTrace);
+	INC_DWORD_STAT(STAT_LagCompensationRewoundShots);
+
+	bool bHit = false;
+
+	FHitResult Hit;
+	EPhysicalSurface SurfaceType = SurfaceType_Default;
+
+	for (USLagCompensationComponent* Component : Components)
+	{
+		if (!Component || Component->GetOwner() == IgnoredActor)
+			continue;
+
+		INC_DWORD_STAT(STAT_LagCompensationActorsTested);
+
+		if (Component->TraceRewound(TraceStart, TraceEnd, Time, Hit, SurfaceType))
+		{
+			if (!bHit || Hit.Distance < OutHit.Distance)
+			{
+				OutHit = Hit;
+				OutSurfaceType = SurfaceType;
+				bHit = true;
+			}
+		}
+	}
+
+	return bHit;
+}
+
+void USLagCompensationSubsystem::UpdateBroadphase()
+{
+	if (Broadphase.BuiltFrame == GFrameCounter)
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_HitboxBroadphaseUpdate);
+
+	Broadphase.Reset();
+
+	for (USLagCompensationComponent* Component : Components)
+	{
+		const FSHitboxFrame* Frame = Component ? Component->GetNewestFrame() : nullptr;
+		if (!Frame)
+			continue;
+
+		// The dead are not shot, whether or not they have unregistered yet
+		const ASCharacter* Character = Cast<ASCharacter>(Component->GetOwner());
+		if ((Character && Character->IsDead()) || Component->IsRagdolled())
+			continue;
+
+		const int32 NumHitboxes = Component->GetNumHitboxes();
+
+		Broadphase.Components.Add(Component);
+		Broadphase.Owners.Add(Component->GetOwner());
+		Broadphase.BoundsCenters.Add(Frame->BoundsCenter);
+		Broadphase.BoundsRadii.Add(Frame->BoundsRadius);
+		Broadphase.FirstHitboxes.Add(Broadphase.Starts.Num());
+		Broadphase.NumHitboxes.Add(NumHitboxes);
+
+		Broadphase.Starts.Append(Frame->Start, NumHitboxes);
+		Broadphase.Ends.Append(Frame->End, NumHitboxes);
+
+		for (int32 i = 0; i < NumHitboxes; i++)
+		{
+			Broadphase.Radii.Add(Component->GetHitboxRadius(i));
+			Broadphase.SurfaceTypes.Add(Component->GetHitboxSurfaceType(i));
+		}
+	}
+
+	Broadphase.BuiltFrame = GFrameCounter;
+}
+
+bool USLagCompensationSubsystem::TraceHitboxes(const FVector& TraceStart, const FVector& TraceEnd, const AActor* IgnoredActor, FHitResult& OutHit, EPhysicalSurface& OutSurfaceType)
+{
+	UpdateBroadphase();
+
+	SCOPE_CYCLE_COUNTER(STAT_HitboxBroadphaseTrace);
+	INC_DWORD_STAT(STAT_HitboxBroadphaseTraces);
+
+	int32 BestActor = INDEX_NONE;
+	int32 BestHitbox = INDEX_NONE;
+	float BestDistance = MAX_FLT;
+	FVector BestImpact = FVector::ZeroVector;
+	FVector BestNormal = FVector::ZeroVector;
+
+	for (int32 i = 0; i < Broadphase.Owners.Num(); i++)
+	{
+		if (Broadphase.Owners[i] == IgnoredActor)
+			continue;
+
+		if (FMath::PointDistToSegment(Broadphase.BoundsCenters[i], TraceStart, TraceEnd) > Broadphase.BoundsRadii[i])
+			continue;
+
+		INC_DWORD_STAT(STAT_HitboxBroadphaseActorsTested);
+
+		const int32 First = Broadphase.FirstHitboxes[i];
+
+		int32 HitIndex;
+		float Distance;
+		FVector Impact, Normal;
+		if (USLagCompensationComponent::TraceCapsules(TraceStart, TraceEnd, &Broadphase.Starts[First], &Broadphase.Ends[First], &Broadphase.Radii[First], Broadphase.NumHitboxes[i], HitIndex, Distance, Impact, Normal)
+			&& Distance < BestDistance)
+		{
+			BestActor = i;
+			BestHitbox = HitIndex;
+			BestDistance = Distance;
+			BestImpact = Impact;
+			BestNormal = Normal;
+		}
+	}
+
+	if (BestActor == INDEX_NONE)
+		return false;
+
+	OutHit = Broadphase.Components[BestActor]->MakeHitResult(BestHitbox, TraceStart, TraceEnd, BestImpact, BestNormal, BestDistance);
+	OutSurfaceType = Broadphase.SurfaceTypes[Broadphase.FirstHitboxes[BestActor] + BestHitbox];
+
+	return true;
+}
+
+bool USLagCompensationSubsystem::IsBroadphaseEnabled()
+{
+	return HitboxBroadphase > 0;
+}
+
+bool USLagCompensationSubsystem::IsEnabled()
+{
+	return LagCompensationEnabled > 0;
+}
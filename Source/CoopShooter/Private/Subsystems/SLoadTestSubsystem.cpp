@@ -0,0 +1,342 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SLoadTestSubsystem.h"
+#include "Subsystems/SNetStatsSubsystem.h"
+#include "AI/SBotController.h"
+#include "SCharacter.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+double USLoadTestSubsystem::WeaponTraceSeconds = 0.0;
+int32 USLoadTestSubsystem::NumWeaponTraces = 0;
+int32 USLoadTestSubsystem::NumAsyncWeaponTraces = 0;
+double USLoadTestSubsystem::HitboxTraceSeconds = 0.0;
+int32 USLoadTestSubsystem::NumHitboxTraces = 0;
+
+static FAutoConsoleCommandWithWorldAndArgs StartLoadTestCommand(
+	TEXT("COOP.LoadTest.Start"),
+	TEXT("Spawn bots and record a load test report. Arguments: <NumBots> [DurationSeconds, 0 runs until COOP.LoadTest.Stop]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USLoadTestSubsystem* LoadTest = World ? World->GetSubsystem<USLoadTestSubsystem>() : nullptr;
+		if (LoadTest)
+		{
+			int32 NumBots = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+			float Duration = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.0f;
+			LoadTest->StartLoadTest(NumBots, Duration);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld StopLoadTestCommand(
+	TEXT("COOP.LoadTest.Stop"),
+	TEXT("Stop the running load test and write its report"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		USLoadTestSubsystem* LoadTest = World ? World->GetSubsystem<USLoadTestSubsystem>() : nullptr;
+		if (LoadTest)
+		{
+			LoadTest->StopLoadTest();
+		}
+	}));
+
+/** Expects the values to be sorted */
+static float GetPercentile(const TArray<float>& SortedValues, float Percentile)
+{
+	if (SortedValues.Num() == 0)
+		return 0.0f;
+
+	int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+	return SortedValues[Index];
+}
+
+static float GetAverage(const TArray<float>& Values)
+{
+	if (Values.Num() == 0)
+		return 0.0f;
+
+	double Total = 0.0;
+	for (float Value : Values)
+	{
+		Total += Value;
+	}
+
+	return Total / Values.Num();
+}
+
+void USLoadTestSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	NumBots = 0;
+	Duration = 0.0f;
+	ElapsedTime = 0.0f;
+	TimeSinceRespawnCheck = 0.0f;
+	StartWeaponTraceSeconds = 0.0;
+	StartNumWeaponTraces = 0;
+	StartNumAsyncWeaponTraces = 0;
+	StartHitboxTraceSeconds = 0.0;
+	StartNumHitboxTraces = 0;
+	StartUsedMemory = 0;
+	PeakUsedMemory = 0;
+	bRunning = false;
+
+	CommandLineBots = 0;
+	CommandLineDuration = 0.0f;
+	bExitWhenDone = false;
+
+	UWorld* World = GetWorld();
+	bInitialized = World && World->IsGameWorld();
+
+	if (bInitialized && World->GetNetMode() != NM_Client)
+	{
+		FParse::Value(FCommandLine::Get(), TEXT("LoadTestBots="), CommandLineBots);
+		FParse::Value(FCommandLine::Get(), TEXT("LoadTestDuration="), CommandLineDuration);
+		bExitWhenDone = FParse::Param(FCommandLine::Get(), TEXT("LoadTestExit"));
+	}
+}
+
+void USLoadTestSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		StopLoadTest();
+	}
+
+	bInitialized = false;
+
+	Super::Deinitialize();
+}
+
+void USLoadTestSubsystem::Tick(float DeltaTime)
+{
+	if (!bRunning)
+	{
+		// Wait for the game mode to be ready before spawning anything
+		if (CommandLineBots > 0 && GetWorld()->HasBegunPlay())
+		{
+			StartLoadTest(CommandLineBots, CommandLineDuration);
+			CommandLineBots = 0;
+		}
+		return;
+	}
+
+	// Real frame time, DeltaTime is clamped and dilated. Servers sleep to their max tick rate so the game thread time leaves that out
+	FrameTimes.Add(FApp::GetDeltaTime() * 1000.0f);
+	GameThreadTimes.Add(FMath::Max(FApp::GetDeltaTime() - FApp::GetIdleTime(), 0.0) * 1000.0f);
+	PeakUsedMemory = FMath::Max<uint64>(PeakUsedMemory, FPlatformMemory::GetStats().UsedPhysical);
+
+	ElapsedTime += FApp::GetDeltaTime();
+	TimeSinceRespawnCheck += DeltaTime;
+
+	if (TimeSinceRespawnCheck >= 1.0f)
+	{
+		TimeSinceRespawnCheck = 0.0f;
+		RespawnBots();
+	}
+
+	if (Duration > 0.0f && ElapsedTime >= Duration)
+	{
+		StopLoadTest();
+
+		if (bExitWhenDone)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+	}
+}
+
+bool USLoadTestSubsystem::IsTickable() const
+{
+	return bInitialized && !IsTemplate() && (bRunning || CommandLineBots > 0);
+}
+
+UWorld* USLoadTestSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USLoadTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USLoadTestSubsystem, STATGROUP_Tickables);
+}
+
+void USLoadTestSubsystem::StartLoadTest(int32 InNumBots, float InDuration)
+{
+	UWorld* World = GetWorld();
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+
+	if (bRunning || !GameMode)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Load test can only be started once, on the server"));
+		return;
+	}
+
+	if (!GameMode->DefaultPawnClass || !GameMode->DefaultPawnClass->IsChildOf(ASCharacter::StaticClass()))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Load test needs the default pawn to be a SCharacter"));
+		return;
+	}
+
+	NumBots = FMath::Max(InNumBots, 1);
+	Duration = InDuration;
+	ElapsedTime = 0.0f;
+	TimeSinceRespawnCheck = 0.0f;
+
+	FrameTimes.Reset();
+	GameThreadTimes.Reset();
+
+	// Reserve up front so recording does not allocate, 60 fps is plenty for a server
+	if (Duration > 0.0f)
+	{
+		FrameTimes.Reserve(FMath::CeilToInt(Duration * 60.0f));
+		GameThreadTimes.Reserve(FMath::CeilToInt(Duration * 60.0f));
+	}
+
+	for (int32 i = 0; i < NumBots; i++)
+	{
+		SpawnBot();
+	}
+
+	StartWeaponTraceSeconds = WeaponTraceSeconds;
+	StartNumWeaponTraces = NumWeaponTraces;
+	StartNumAsyncWeaponTraces = NumAsyncWeaponTraces;
+	StartHitboxTraceSeconds = HitboxTraceSeconds;
+	StartNumHitboxTraces = NumHitboxTraces;
+	StartUsedMemory = FPlatformMemory::GetStats().UsedPhysical;
+	PeakUsedMemory = StartUsedMemory;
+
+	bRunning = true;
+
+	UE_LOG(LogTemp, Log, TEXT("Load test started with %d bots"), NumBots);
+}
+
+void USLoadTestSubsystem::StopLoadTest()
+{
+	if (!bRunning)
+		return;
+
+	bRunning = false;
+
+	UE_LOG(LogTemp, Log, TEXT("Wrote load test report to %s"), *WriteReport());
+
+	for (ASBotController* Bot : Bots)
+	{
+		if (!Bot)
+			continue;
+
+		if (APawn* BotPawn = Bot->GetPawn())
+		{
+			BotPawn->Destroy();
+		}
+
+		Bot->Destroy();
+	}
+
+	Bots.Reset();
+}
+
+void USLoadTestSubsystem::SpawnBot()
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ASBotController* Bot = GetWorld()->SpawnActor<ASBotController>(ASBotController::StaticClass(), SpawnParams);
+	if (!Bot)
+		return;
+
+	Bots.Add(Bot);
+	GetWorld()->GetAuthGameMode()->RestartPlayer(Bot);
+}
+
+void USLoadTestSubsystem::RespawnBots()
+{
+	AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+	if (!GameMode)
+		return;
+
+	for (ASBotController* Bot : Bots)
+	{
+		if (Bot && !Bot->GetPawn())
+		{
+			GameMode->RestartPlayer(Bot);
+		}
+	}
+}
+
+FString USLoadTestSubsystem::WriteReport() const
+{
+	UWorld* World = GetWorld();
+
+	TArray<float> SortedFrameTimes = FrameTimes;
+	SortedFrameTimes.Sort();
+
+	TArray<float> SortedGameThreadTimes = GameThreadTimes;
+	SortedGameThreadTimes.Sort();
+
+	const double TraceMs = (WeaponTraceSeconds - StartWeaponTraceSeconds) * 1000.0;
+	const int32 NumTraces = NumWeaponTraces - StartNumWeaponTraces;
+	const int32 NumAsyncTraces = NumAsyncWeaponTraces - StartNumAsyncWeaponTraces;
+	const double HitboxTraceMs = (HitboxTraceSeconds - StartHitboxTraceSeconds) * 1000.0;
+	const int32 NumHitboxTracesRecorded = NumHitboxTraces - StartNumHitboxTraces;
+	const float MB = 1024.0f * 1024.0f;
+
+	FString Report = TEXT("Stat,Value\n");
+	Report += FString::Printf(TEXT("Map,%s\n"), *World->GetMapName());
+	Report += FString::Printf(TEXT("Bots,%d\n"), NumBots);
+	Report += FString::Printf(TEXT("Seconds,%.1f\n"), ElapsedTime);
+	Report += FString::Printf(TEXT("Frames,%d\n"), FrameTimes.Num());
+
+	Report += FString::Printf(TEXT("FrameMsAverage,%.3f\n"), GetAverage(FrameTimes));
+	Report += FString::Printf(TEXT("FrameMsP50,%.3f\n"), GetPercentile(SortedFrameTimes, 0.5f));
+	Report += FString::Printf(TEXT("FrameMsP90,%.3f\n"), GetPercentile(SortedFrameTimes, 0.9f));
+	Report += FString::Printf(TEXT("FrameMsP95,%.3f\n"), GetPercentile(SortedFrameTimes, 0.95f));
+	Report += FString::Printf(TEXT("FrameMsP99,%.3f\n"), GetPercentile(SortedFrameTimes, 0.99f));
+	Report += FString::Printf(TEXT("FrameMsMax,%.3f\n"), GetPercentile(SortedFrameTimes, 1.0f));
+
+	Report += FString::Printf(TEXT("GameThreadMsAverage,%.3f\n"), GetAverage(GameThreadTimes));
+	Report += FString::Printf(TEXT("GameThreadMsP50,%.3f\n"), GetPercentile(SortedGameThreadTimes, 0.5f));
+	Report += FString::Printf(TEXT("GameThreadMsP99,%.3f\n"), GetPercentile(SortedGameThreadTimes, 0.99f));
+	Report += FString::Printf(TEXT("GameThreadMsMax,%.3f\n"), GetPercentile(SortedGameThreadTimes, 1.0f));
+
+	Report += FString::Printf(TEXT("WeaponTraces,%d\n"), NumTraces);
+	Report += FString::Printf(TEXT("WeaponTraceMsTotal,%.3f\n"), TraceMs);
+	Report += FString::Printf(TEXT("WeaponTraceMsPerFrame,%.4f\n"), FrameTimes.Num() > 0 ? TraceMs / FrameTimes.Num() : 0.0);
+	Report += FString::Printf(TEXT("WeaponTraceUsPerTrace,%.3f\n"), NumTraces > 0 ? TraceMs * 1000.0 / NumTraces : 0.0);
+	Report += FString::Printf(TEXT("AsyncWeaponTraces,%d\n"), NumAsyncTraces);
+
+	Report += FString::Printf(TEXT("HitboxTraces,%d\n"), NumHitboxTracesRecorded);
+	Report += FString::Printf(TEXT("HitboxTraceMsTotal,%.3f\n"), HitboxTraceMs);
+	Report += FString::Printf(TEXT("HitboxTraceUsPerTrace,%.3f\n"), NumHitboxTracesRecorded > 0 ? HitboxTraceMs * 1000.0 / NumHitboxTracesRecorded : 0.0);
+
+	Report += FString::Printf(TEXT("MemoryStartMB,%.1f\n"), StartUsedMemory / MB);
+	Report += FString::Printf(TEXT("MemoryPeakMB,%.1f\n"), PeakUsedMemory / MB);
+	Report += FString::Printf(TEXT("MemoryEndMB,%.1f\n"), FPlatformMemory::GetStats().UsedPhysical / MB);
+
+	if (USNetStatsSubsystem* NetStats = World->GetSubsystem<USNetStatsSubsystem>())
+	{
+		Report += FString::Printf(TEXT("PeakPlayerBytesPerSecond,%d\n"), NetStats->GetPeakPlayerBytesPerSecond());
+		Report += FString::Printf(TEXT("SamplesOverBudget,%d\n"), NetStats->GetNumOverBudgetSamples());
+	}
+
+#if DO_ENABLE_NET_TEST
+	// Label the run with the emulated network conditions real clients were tested under
+	if (UNetDriver* NetDriver = World->GetNetDriver())
+	{
+		Report += FString::Printf(TEXT("PktLag,%d\n"), NetDriver->PacketSimulationSettings.PktLag);
+		Report += FString::Printf(TEXT("PktLoss,%d\n"), NetDriver->PacketSimulationSettings.PktLoss);
+	}
+#endif
+
+	const FString Filename = FPaths::Combine(FPaths::ProfilingDir(), TEXT("LoadTest"), FString::Printf(TEXT("LoadTest-%s-%s.csv"), *World->GetMapName(), *FDateTime::Now().ToString()));
+
+	return FFileHelper::SaveStringToFile(Report, *Filename) ? Filename : FString();
+}
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SNetStatsSubsystem.h"
+#include "Net/SNetStats.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Peak Player Bytes/s"), STAT_NetPeakPlayerBytesPerSecond, STATGROUP_CoopShooterNet);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Players Over Budget"), STAT_NetPlayersOverBudget, STATGROUP_CoopShooterNet);
+
+static int32 NetBudgetBytesPerPlayer = 8000;
+FAutoConsoleVariableRef CVARNetBudgetBytesPerPlayer(
+	TEXT("COOP.Net.BudgetBytesPerPlayer"),
+	NetBudgetBytesPerPlayer,
+	TEXT("The most bytes per second the server should send a single player, 0 disables the check"),
+	ECVF_Default);
+
+static int32 NetStatsWriteCSV = 1;
+FAutoConsoleVariableRef CVARNetStatsWriteCSV(
+	TEXT("COOP.NetStats.CSV"),
+	NetStatsWriteCSV,
+	TEXT("Write the net stats to Saved/Profiling/NetStats when a match ends"),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld DumpNetStatsCommand(
+	TEXT("COOP.NetStats.Dump"),
+	TEXT("Print the CoopShooter net stats for this match to the log"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		FSNetStats::Dump(World ? World->GetTimeSeconds() : 0.0f);
+	}));
+
+static FAutoConsoleCommandWithWorld WriteNetStatsCommand(
+	TEXT("COOP.NetStats.WriteCSV"),
+	TEXT("Write the CoopShooter net stats for this match to Saved/Profiling/NetStats"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		USNetStatsSubsystem* NetStats = World ? World->GetSubsystem<USNetStatsSubsystem>() : nullptr;
+		if (NetStats)
+		{
+			UE_LOG(LogTemp, Log, TEXT("Wrote net stats to %s"), *NetStats->WriteCSV());
+		}
+	}));
+
+void USNetStatsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ResetSamples();
+
+	// Clients share the process with the server in PIE, only the server starts a new match
+	UWorld* World = GetWorld();
+	bInitialized = World && World->IsGameWorld();
+
+	if (bInitialized && World->GetNetMode() != NM_Client)
+	{
+		FSNetStats::Reset();
+	}
+}
+
+void USNetStatsSubsystem::Deinitialize()
+{
+	UWorld* World = GetWorld();
+
+	if (bInitialized && NetStatsWriteCSV > 0 && World && World->GetNetMode() != NM_Client)
+	{
+		WriteCSV();
+	}
+
+	bInitialized = false;
+
+	Super::Deinitialize();
+}
+
+void USNetStatsSubsystem::ResetSamples()
+{
+	TimeSinceLastSample = 0.0f;
+	PeakPlayerBytesPerSecond = 0;
+	NumOverBudgetSamples = 0;
+}
+
+void USNetStatsSubsystem::Tick(float DeltaTime)
+{
+	TimeSinceLastSample += DeltaTime;
+
+	// Connections only update their rate once a second
+	if (TimeSinceLastSample >= 1.0f)
+	{
+		TimeSinceLastSample = 0.0f;
+		SampleConnections();
+	}
+}
+
+bool USNetStatsSubsystem::IsTickable() const
+{
+	return bInitialized && !IsTemplate();
+}
+
+UWorld* USNetStatsSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USNetStatsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USNetStatsSubsystem, STATGROUP_Tickables);
+}
+
+void USNetStatsSubsystem::SampleConnections()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver || !NetDriver->IsServer())
+		return;
+
+	int32 NumOverBudget = 0;
+
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (!Connection)
+			continue;
+
+		FString ConnectionName = Connection->LowLevelGetRemoteAddress(true);
+		if (Connection->PlayerController && Connection->PlayerController->PlayerState)
+		{
+			ConnectionName = Connection->PlayerController->PlayerState->GetPlayerName();
+		}
+
+		const int32 BytesPerSecond = Connection->OutBytesPerSecond;
+		const bool bOverBudget = NetBudgetBytesPerPlayer > 0 && BytesPerSecond > NetBudgetBytesPerPlayer;
+
+		if (bOverBudget)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s is being sent %d bytes/s, over the %d bytes/s budget"), *ConnectionName, BytesPerSecond, NetBudgetBytesPerPlayer);
+			NumOverBudget++;
+		}
+
+		PeakPlayerBytesPerSecond = FMath::Max(PeakPlayerBytesPerSecond, BytesPerSecond);
+		FSNetStats::RecordConnectionSample(ConnectionName, BytesPerSecond, bOverBudget);
+	}
+
+	NumOverBudgetSamples += NumOverBudget;
+
+	SET_DWORD_STAT(STAT_NetPeakPlayerBytesPerSecond, PeakPlayerBytesPerSecond);
+	SET_DWORD_STAT(STAT_NetPlayersOverBudget, NumOverBudget);
+}
+
+FString USNetStatsSubsystem::WriteCSV() const
+{
+	UWorld* World = GetWorld();
+
+	const FString Filename = FPaths::Combine(FPaths::ProfilingDir(), TEXT("NetStats"), FString::Printf(TEXT("NetStats-%s-%s.csv"), *World->GetMapName(), *FDateTime::Now().ToString()));
+
+	return FSNetStats::WriteCSV(Filename, World->GetTimeSeconds()) ? Filename : FString();
+}
+
+int32 USNetStatsSubsystem::GetBudgetBytesPerPlayer()
+{
+	return NetBudgetBytesPerPlayer;
+}
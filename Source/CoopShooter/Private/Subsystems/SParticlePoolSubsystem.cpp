@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SParticlePoolSubsystem.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/World.h"
+#include "CoopShooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Particle Pool Hits"), STAT_ParticlePoolHits, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Particle Pool Misses"), STAT_ParticlePoolMisses, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Particle Pool Steals"), STAT_ParticlePoolSteals, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Particle Components"), STAT_ParticlePoolComponents, STATGROUP_CoopShooter);
+
+static int32 ParticlePoolEnabled = 1;
+FAutoConsoleVariableRef CVARParticlePoolEnabled(
+	TEXT("COOP.FX.Pool"),
+	ParticlePoolEnabled,
+	TEXT("Recycle weapon particle components instead of spawning new ones"),
+	ECVF_Default);
+
+static int32 ParticlePoolMaxPerTemplate = 32;
+FAutoConsoleVariableRef CVARParticlePoolMaxPerTemplate(
+	TEXT("COOP.FX.PoolMaxPerTemplate"),
+	ParticlePoolMaxPerTemplate,
+	TEXT("The most components a single particle template can have, the least recently used one is stolen past this"),
+	ECVF_Default);
+
+void USParticlePoolSubsystem::Deinitialize()
+{
+	for (TPair<UParticleSystem*, FSParticlePool>& Pool : Pools)
+	{
+		for (UParticleSystemComponent* Component : Pool.Value.Components)
+		{
+			if (Component && !Component->IsPendingKill())
+			{
+				Component->DestroyComponent();
+			}
+		}
+
+		DEC_DWORD_STAT_BY(STAT_ParticlePoolComponents, Pool.Value.Components.Num());
+	}
+
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+void USParticlePoolSubsystem::Preallocate(UParticleSystem* Template, int32 Count)
+{
+	if (!Template || !CanUsePool())
+		return;
+
+	FSParticlePool& Pool = Pools.FindOrAdd(Template);
+	const int32 NumToCreate = FMath::Min(Count, ParticlePoolMaxPerTemplate) - Pool.Components.Num();
+
+	for (int32 i = 0; i < NumToCreate; i++)
+	{
+		Pool.Components.Add(CreateComponent(Template));
+		Pool.LastUsedTimes.Add(0.0f);
+	}
+}
+
+UParticleSystemComponent* USParticlePoolSubsystem::SpawnEmitterAtLocation(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	if (!Template)
+		return nullptr;
+
+	if (!CanUsePool())
+		return UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Template, Location, Rotation);
+
+	UParticleSystemComponent* Component = AcquireComponent(Template);
+
+	Component->SetAbsolute(true, true, true);
+	Component->SetWorldLocationAndRotation(Location, Rotation);
+	Component->ActivateSystem(true);
+
+	return Component;
+}
+
+UParticleSystemComponent* USParticlePoolSubsystem::SpawnEmitterAttached(UParticleSystem* Template, USceneComponent* AttachToComponent, FName AttachPointName)
+{
+	if (!Template || !AttachToComponent)
+		return nullptr;
+
+	if (!CanUsePool())
+		return UGameplayStatics::SpawnEmitterAttached(Template, AttachToComponent, AttachPointName);
+
+	UParticleSystemComponent* Component = AcquireComponent(Template);
+
+	Component->SetAbsolute(false, false, false);
+	Component->AttachToComponent(AttachToComponent, FAttachmentTransformRules::KeepRelativeTransform, AttachPointName);
+	Component->SetRelativeLocationAndRotation(FVector::ZeroVector, FRotator::ZeroRotator);
+	Component->ActivateSystem(true);
+
+	return Component;
+}
+
+UParticleSystemComponent* USParticlePoolSubsystem::AcquireComponent(UParticleSystem* Template)
+{
+	FSParticlePool& Pool = Pools.FindOrAdd(Template);
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	int32 FoundIndex = INDEX_NONE;
+	int32 OldestIndex = INDEX_NONE;
+
+	for (int32 i = Pool.Components.Num() - 1; i >= 0; i--)
+	{
+		UParticleSystemComponent* Component = Pool.Components[i];
+
+		// Destroyed along with something it was attached to
+		if (!Component || Component->IsPendingKill())
+		{
+			Pool.Components.RemoveAtSwap(i);
+			Pool.LastUsedTimes.RemoveAtSwap(i);
+			DEC_DWORD_STAT(STAT_ParticlePoolComponents);
+			continue;
+		}
+
+		if (!Component->IsActive())
+		{
+			FoundIndex = i;
+			break;
+		}
+
+		if (OldestIndex == INDEX_NONE || Pool.LastUsedTimes[i] < Pool.LastUsedTimes[OldestIndex])
+		{
+			OldestIndex = i;
+		}
+	}
+
+	if (FoundIndex != INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_ParticlePoolHits);
+	}
+	else if (Pool.Components.Num() < FMath::Max(ParticlePoolMaxPerTemplate, 1))
+	{
+		INC_DWORD_STAT(STAT_ParticlePoolMisses);
+
+		FoundIndex = Pool.Components.Add(CreateComponent(Template));
+		Pool.LastUsedTimes.Add(Now);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_ParticlePoolSteals);
+
+		// Every component is busy, cut the one that has been playing the longest short
+		FoundIndex = OldestIndex;
+		Pool.Components[FoundIndex]->DeactivateImmediate();
+	}
+
+	UParticleSystemComponent* Component = Pool.Components[FoundIndex];
+	Pool.LastUsedTimes[FoundIndex] = Now;
+
+	// Could still be attached from when it was last used
+	if (Component->GetAttachParent())
+	{
+		Component->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+
+	return Component;
+}
+
+UParticleSystemComponent* USParticlePoolSubsystem::CreateComponent(UParticleSystem* Template)
+{
+	UWorld* World = GetWorld();
+
+	UParticleSystemComponent* Component = NewObject<UParticleSystemComponent>(World);
+	Component->bAutoDestroy = false;
+	Component->bAutoActivate = false;
+	Component->bAllowAnyoneToDestroyMe = true;
+	Component->SecondsBeforeInactive = 0.0f;
+	Component->SetTemplate(Template);
+	Component->RegisterComponentWithWorld(World);
+
+	INC_DWORD_STAT(STAT_ParticlePoolComponents);
+
+	return Component;
+}
+
+bool USParticlePoolSubsystem::CanUsePool() const
+{
+	return ParticlePoolEnabled > 0 && GetWorld()->GetNetMode() != NM_DedicatedServer;
+}
@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SPickupSubsystem.h"
+#include "SWeaponPickup.h"
+#include "SCharacter.h"
+#include "CoopShooter.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Subsystem Tick"), STAT_PickupSubsystemTick, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickups"), STAT_Pickups, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Proximity Queries"), STAT_PickupQueries, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Tested"), STAT_PickupsTested, STATGROUP_CoopShooter);
+
+static float PickupRadius = 150.0f;
+FAutoConsoleVariableRef CVARPickupRadius(
+	TEXT("COOP.Pickup.Radius"),
+	PickupRadius,
+	TEXT("How close a character has to be to a pickup to take it, also the size of the grid cells"),
+	ECVF_Default);
+
+static float PickupLifetime = 60.0f;
+FAutoConsoleVariableRef CVARPickupLifetime(
+	TEXT("COOP.Pickup.Lifetime"),
+	PickupLifetime,
+	TEXT("Seconds before a pickup nobody took is despawned, 0 keeps them forever"),
+	ECVF_Default);
+
+static int32 PickupMaxCount = 64;
+FAutoConsoleVariableRef CVARPickupMaxCount(
+	TEXT("COOP.Pickup.MaxCount"),
+	PickupMaxCount,
+	TEXT("The most pickups in the world, the oldest are despawned past this. 0 for no limit"),
+	ECVF_Default);
+
+FIntPoint FSPickupGrid::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void FSPickupGrid::Reset()
+{
+	CellHeads.Reset();
+	NextInCell.Reset();
+	Locations.Reset();
+}
+
+void USPickupSubsystem::Deinitialize()
+{
+	Pickups.Empty();
+	SpawnTimes.Empty();
+	Grid.Reset();
+
+	Super::Deinitialize();
+}
+
+void USPickupSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupSubsystemTick);
+
+	DespawnPickups();
+	UpdateGrid();
+	ResolvePickups();
+
+	SET_DWORD_STAT(STAT_Pickups, Pickups.Num());
+}
+
+bool USPickupSubsystem::IsTickable() const
+{
+	return Pickups.Num() > 0 && !IsTemplate();
+}
+
+UWorld* USPickupSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId USPickupSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USPickupSubsystem, STATGROUP_Tickables);
+}
+
+void USPickupSubsystem::RegisterPickup(ASWeaponPickup* Pickup)
+{
+	if (!Pickup || Pickups.Contains(Pickup))
+		return;
+
+	Pickups.Add(Pickup);
+	SpawnTimes.Add(GetWorld()->TimeSeconds);
+}
+
+void USPickupSubsystem::UnregisterPickup(ASWeaponPickup* Pickup)
+{
+	// Keep the order, the oldest are despawned first
+	int32 Index = Pickups.Find(Pickup);
+	if (Index != INDEX_NONE)
+	{
+		Pickups.RemoveAt(Index);
+		SpawnTimes.RemoveAt(Index);
+	}
+}
+
+void USPickupSubsystem::DespawnPickups()
+{
+	const float TimeSeconds = GetWorld()->TimeSeconds;
+	const int32 NumOverCap = PickupMaxCount > 0 ? FMath::Max(Pickups.Num() - PickupMaxCount, 0) : 0;
+
+	PickupsToDestroy.Reset();
+
+	for (int32 i = 0; i < Pickups.Num(); i++)
+	{
+		const bool bExpired = PickupLifetime > 0.0f && TimeSeconds - SpawnTimes[i] > PickupLifetime;
+
+		// Oldest first, nothing after this one is over the cap or any older
+		if (i >= NumOverCap && !bExpired)
+			break;
+
+		PickupsToDestroy.Add(Pickups[i]);
+	}
+
+	// Destroying unregisters the pickup, so not while going over the array
+	for (ASWeaponPickup* Pickup : PickupsToDestroy)
+	{
+		if (Pickup && !Pickup->IsPendingKill())
+		{
+			Pickup->Destroy();
+		}
+		else
+		{
+			UnregisterPickup(Pickup);
+		}
+	}
+
+	PickupsToDestroy.Reset();
+}
+
+void USPickupSubsystem::UpdateGrid()
+{
+	Grid.Reset();
+	Grid.CellSize = FMath::Max(PickupRadius, 1.0f);
+
+	for (int32 i = 0; i < Pickups.Num(); i++)
+	{
+		// Dropped weapons can still be falling or sliding, so the grid is built from where they are now
+		const FVector Location = Pickups[i] ? Pickups[i]->GetActorLocation() : FVector(WORLD_MAX);
+		const FIntPoint Cell = Grid.GetCell(Location);
+
+		const int32* Head = Grid.CellHeads.Find(Cell);
+		Grid.NextInCell.Add(Head ? *Head : INDEX_NONE);
+		Grid.Locations.Add(Location);
+		Grid.CellHeads.Add(Cell, i);
+	}
+}
+
+int32 USPickupSubsystem::FindClosestPickup(const FVector& Location) const
+{
+	INC_DWORD_STAT(STAT_PickupQueries);
+
+	const FIntPoint Cell = Grid.GetCell(Location);
+
+	int32 Closest = INDEX_NONE;
+	float ClosestDistanceSquared = FMath::Square(PickupRadius);
+
+	// The cells are as big as the radius, so the pickups in range are always in the cells around this one
+	for (int32 X = -1; X <= 1; X++)
+	{
+		for (int32 Y = -1; Y <= 1; Y++)
+		{
+			const int32* Head = Grid.CellHeads.Find(Cell + FIntPoint(X, Y));
+
+			for (int32 i = Head ? *Head : INDEX_NONE; i != INDEX_NONE; i = Grid.NextInCell[i])
+			{
+				INC_DWORD_STAT(STAT_PickupsTested);
+
+				const float DistanceSquared = FVector::DistSquared(Location, Grid.Locations[i]);
+				if (DistanceSquared <= ClosestDistanceSquared)
+				{
+					Closest = i;
+					ClosestDistanceSquared = DistanceSquared;
+				}
+			}
+		}
+	}
+
+	return Closest;
+}
+
+void USPickupSubsystem::ResolvePickups()
+{
+	PickupsToDestroy.Reset();
+
+	for (FConstControllerIterator It = GetWorld()->GetControllerIterator(); It; ++It)
+	{
+		AController* Controller = It->Get();
+		ASCharacter* Character = Controller ? Cast<ASCharacter>(Controller->GetPawn()) : nullptr;
+		if (!Character || Character->IsDead())
+			continue;
+
+		int32 Index = FindClosestPickup(Character->GetActorLocation());
+		if (Index == INDEX_NONE)
+			continue;
+
+		// Someone else got to it first this frame
+		ASWeaponPickup* Pickup = Pickups[Index];
+		if (!Pickup || PickupsToDestroy.Contains(Pickup))
+			continue;
+
+		if (Pickup->GiveTo(Character))
+		{
+			PickupsToDestroy.Add(Pickup);
+		}
+	}
+
+	for (ASWeaponPickup* Pickup : PickupsToDestroy)
+	{
+		Pickup->Destroy();
+	}
+
+	PickupsToDestroy.Reset();
+}
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SWeaponPoolSubsystem.h"
+#include "SWeapon.h"
+#include "Engine/World.h"
+#include "CoopShooter.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Pool Hits"), STAT_WeaponPoolHits, STATGROUP_CoopShooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Pool Misses"), STAT_WeaponPoolMisses, STATGROUP_CoopShooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Weapons"), STAT_PooledWeapons, STATGROUP_CoopShooter);
+
+static int32 WeaponPoolMaxSize = 16;
+FAutoConsoleVariableRef CVARWeaponPoolMaxSize(
+	TEXT("COOP.WeaponPoolMaxSize"),
+	WeaponPoolMaxSize,
+	TEXT("The most unused weapon actors kept by the server, weapons released past this are destroyed. 0 turns the pool off"),
+	ECVF_Default);
+
+void USWeaponPoolSubsystem::Deinitialize()
+{
+	PooledWeapons.Empty();
+	SET_DWORD_STAT(STAT_PooledWeapons, 0);
+
+	Super::Deinitialize();
+}
+
+ASWeapon* USWeaponPoolSubsystem::AcquireWeapon(TSubclassOf<ASWeapon> WeaponClass, AActor* NewOwner)
+{
+	if (!WeaponClass)
+		return nullptr;
+
+	// Weapons can be destroyed while pooled, e.g. by a level unloading
+	PooledWeapons.RemoveAllSwap([](ASWeapon* Weapon) { return !Weapon || Weapon->IsPendingKill(); });
+
+	ASWeapon* Weapon = nullptr;
+
+	int32 Index = PooledWeapons.IndexOfByPredicate([&WeaponClass](ASWeapon* Pooled) { return Pooled->GetClass() == WeaponClass; });
+	if (Index != INDEX_NONE)
+	{
+		Weapon = PooledWeapons[Index];
+		PooledWeapons.RemoveAtSwap(Index);
+
+		Weapon->FlushNetDormancy();
+		Weapon->SetActorHiddenInGame(false);
+		Weapon->SetActorEnableCollision(true);
+
+		INC_DWORD_STAT(STAT_WeaponPoolHits);
+	}
+	else
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Weapon = GetWorld()->SpawnActor<ASWeapon>(WeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+
+		INC_DWORD_STAT(STAT_WeaponPoolMisses);
+	}
+
+	if (Weapon)
+	{
+		Weapon->SetOwner(NewOwner);
+	}
+
+	SET_DWORD_STAT(STAT_PooledWeapons, PooledWeapons.Num());
+	return Weapon;
+}
+
+void USWeaponPoolSubsystem::ReleaseWeapon(ASWeapon* Weapon)
+{
+	if (!Weapon || Weapon->IsPendingKill())
+		return;
+
+	Weapon->ResetForPool();
+
+	if (PooledWeapons.Num() >= WeaponPoolMaxSize)
+	{
+		Weapon->Destroy();
+		return;
+	}
+
+	// The weapon went dormant in ResetForPool, wake it so the net driver sends the hidden state below before it sleeps again.
+	// The replication graph never gathers pooled weapons, it closes their channels in OnCharacterWeaponChanged instead
+	Weapon->FlushNetDormancy();
+	Weapon->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	Weapon->SetOwner(nullptr);
+	Weapon->SetActorHiddenInGame(true);
+	Weapon->SetActorEnableCollision(false);
+
+	PooledWeapons.Add(Weapon);
+	SET_DWORD_STAT(STAT_PooledWeapons, PooledWeapons.Num());
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SWeapon.h"
+#include "SWeaponPickup.h"
+#include "Subsystems/SWeaponPoolSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSDormancyTest, "CoopShooter.Net.Dormancy",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/** Idle weapons and pickups stay dormant on the server, a weapon only wakes while it fires and sleeps again once pooled */
+bool FSDormancyTest::RunTest(const FString& Parameters)
+{
+	IConsoleVariable* AsyncTraces = IConsoleManager::Get().FindConsoleVariable(TEXT("COOP.AsyncWeaponTraces"));
+	IConsoleVariable* WeaponDormancy = IConsoleManager::Get().FindConsoleVariable(TEXT("COOP.Net.WeaponDormancy"));
+	IConsoleVariable* PoolSize = IConsoleManager::Get().FindConsoleVariable(TEXT("COOP.WeaponPoolMaxSize"));
+	if (!TestNotNull(TEXT("COOP.AsyncWeaponTraces"), AsyncTraces) || !TestNotNull(TEXT("COOP.Net.WeaponDormancy"), WeaponDormancy) || !TestNotNull(TEXT("COOP.WeaponPoolMaxSize"), PoolSize))
+		return false;
+
+	// Trace on the spot so the shot wakes the weapon without ticking the world
+	const int32 OldAsyncTraces = AsyncTraces->GetInt();
+	const int32 OldWeaponDormancy = WeaponDormancy->GetInt();
+	const int32 OldPoolSize = PoolSize->GetInt();
+	AsyncTraces->Set(0);
+	WeaponDormancy->Set(1);
+	PoolSize->Set(FMath::Max(OldPoolSize, 1));
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+
+	USWeaponPoolSubsystem* WeaponPool = World->GetSubsystem<USWeaponPoolSubsystem>();
+	if (TestNotNull(TEXT("Weapon pool"), WeaponPool))
+	{
+		AActor* Shooter = World->SpawnActor<AActor>();
+
+		// A weapon that has just been picked up or equipped has nothing to send yet
+		ASWeapon* Weapon = WeaponPool->AcquireWeapon(ASWeapon::StaticClass(), Shooter);
+		if (TestNotNull(TEXT("Weapon"), Weapon))
+		{
+			TestEqual(TEXT("Equipped weapon is dormant"), (int32)Weapon->NetDormancy, (int32)DORM_DormantAll);
+
+			Weapon->Fire(FVector::ZeroVector, FRotator::ZeroRotator, 0.0f);
+			TestEqual(TEXT("Firing wakes the weapon"), (int32)Weapon->NetDormancy, (int32)DORM_Awake);
+
+			WeaponPool->ReleaseWeapon(Weapon);
+			TestEqual(TEXT("Pooled weapon is dormant"), (int32)Weapon->NetDormancy, (int32)DORM_DormantAll);
+
+			// Taking it out of the pool again only flushes it, it stays asleep until it fires
+			ASWeapon* ReusedWeapon = WeaponPool->AcquireWeapon(ASWeapon::StaticClass(), Shooter);
+			TestTrue(TEXT("Weapon came from the pool"), ReusedWeapon == Weapon);
+			TestEqual(TEXT("Reused weapon is dormant"), (int32)Weapon->NetDormancy, (int32)DORM_DormantAll);
+		}
+	}
+
+	// A pickup never changes, it replicates once and sleeps until it is picked up and destroyed
+	ASWeaponPickup* Pickup = World->SpawnActor<ASWeaponPickup>();
+	if (TestNotNull(TEXT("Pickup"), Pickup))
+	{
+		TestTrue(TEXT("Idle pickup is dormant"), Pickup->NetDormancy > DORM_Awake);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	AsyncTraces->Set(OldAsyncTraces);
+	WeaponDormancy->Set(OldWeaponDormancy);
+	PoolSize->Set(OldPoolSize);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
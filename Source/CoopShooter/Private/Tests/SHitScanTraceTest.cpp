@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SWeapon.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSHitScanTraceNetSerializeTest, "CoopShooter.Net.HitScanTraceNetSerialize",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/** Round trips random shots through FHitScanTrace::NetSerialize and checks the quantization error stays in bounds */
+bool FSHitScanTraceNetSerializeTest::RunTest(const FString& Parameters)
+{
+	// 14 bit octahedral directions are off by at most ~0.015 degrees, 14 bit distances by half a step of 10000 / 16383
+	const float MaxAngleErrorDegrees = 0.02f;
+	const float MaxDistanceError = 0.5f * FHitScanTrace::MaxDistance / ((1 << FHitScanTrace::DistanceBits) - 1) + 0.01f;
+	const int32 NumShots = 20000;
+
+	FRandomStream Random(1337);
+
+	TArray<FVector> Directions;
+	Directions.Add(FVector::UpVector);
+	Directions.Add(-FVector::UpVector);
+	Directions.Add(FVector::ForwardVector);
+	Directions.Add(-FVector::RightVector);
+	Directions.Add(FVector(1.0f, -1.0f, -1.0f).GetSafeNormal());
+	while (Directions.Num() < NumShots)
+	{
+		Directions.Add(Random.VRand());
+	}
+
+	float WorstAngleDegrees = 0.0f;
+	float WorstDistanceError = 0.0f;
+
+	for (int32 i = 0; i < Directions.Num(); i++)
+	{
+		FHitScanTrace Sent;
+		Sent.ShotIndex = (uint16)i;
+		Sent.SurfaceType = (EPhysicalSurface)(i % SurfaceType_Max);
+		Sent.Direction = Directions[i];
+		Sent.Distance = Random.FRandRange(0.0f, FHitScanTrace::MaxDistance);
+
+		FBitWriter Writer(128, true);
+		bool bSaved = false;
+		Sent.NetSerialize(Writer, nullptr, bSaved);
+
+		// Every shot costs the same 64 bits
+		if (!TestTrue(TEXT("Saved"), bSaved) || !TestEqual(TEXT("Bits per shot"), Writer.GetNumBits(), (int64)64))
+			return false;
+
+		FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+		FHitScanTrace Received;
+		bool bLoaded = false;
+		Received.NetSerialize(Reader, nullptr, bLoaded);
+
+		if (!TestTrue(TEXT("Loaded"), bLoaded && !Reader.IsError()))
+			return false;
+
+		TestEqual(TEXT("Shot index"), Received.ShotIndex, Sent.ShotIndex);
+		TestEqual(TEXT("Surface type"), (int32)Received.SurfaceType, (int32)Sent.SurfaceType);
+
+		const float CosAngle = FMath::Clamp(FVector::DotProduct(Sent.Direction, Received.Direction), -1.0f, 1.0f);
+		WorstAngleDegrees = FMath::Max(WorstAngleDegrees, FMath::RadiansToDegrees(FMath::Acos(CosAngle)));
+		WorstDistanceError = FMath::Max(WorstDistanceError, FMath::Abs(Received.Distance - Sent.Distance));
+	}
+
+	AddInfo(FString::Printf(TEXT("Worst direction error %.4f degrees, worst distance error %.3f units"), WorstAngleDegrees, WorstDistanceError));
+
+	TestTrue(FString::Printf(TEXT("Direction error %.4f degrees is within %.4f"), WorstAngleDegrees, MaxAngleErrorDegrees), WorstAngleDegrees <= MaxAngleErrorDegrees);
+	TestTrue(FString::Printf(TEXT("Distance error %.3f is within %.3f"), WorstDistanceError, MaxDistanceError), WorstDistanceError <= MaxDistanceError);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
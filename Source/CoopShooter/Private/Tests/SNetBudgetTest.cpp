@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Subsystems/SNetStatsSubsystem.h"
+#include "Subsystems/SLoadTestSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Tests/AutomationCommon.h"
+#include "Tests/AutomationEditorCommon.h"
+
+static int32 NetBudgetTestClients = 2;
+FAutoConsoleVariableRef CVARNetBudgetTestClients(
+	TEXT("COOP.Net.BudgetTest.Clients"),
+	NetBudgetTestClients,
+	TEXT("Clients connected to the dedicated server by the player net budget automation test"),
+	ECVF_Default);
+
+static int32 NetBudgetTestBots = 8;
+FAutoConsoleVariableRef CVARNetBudgetTestBots(
+	TEXT("COOP.Net.BudgetTest.Bots"),
+	NetBudgetTestBots,
+	TEXT("Load test bots fighting on the server during the player net budget automation test"),
+	ECVF_Default);
+
+static float NetBudgetTestDuration = 30.0f;
+FAutoConsoleVariableRef CVARNetBudgetTestDuration(
+	TEXT("COOP.Net.BudgetTest.Duration"),
+	NetBudgetTestDuration,
+	TEXT("Seconds the bots fight for before the player net budget automation test checks the samples"),
+	ECVF_Default);
+
+/** The PIE world that is the server, null until PIE has started */
+static UWorld* FindServerWorld()
+{
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		UWorld* World = Context.World();
+		if (World && Context.WorldType == EWorldType::PIE && World->GetNetMode() != NM_Client)
+			return World;
+	}
+
+	return nullptr;
+}
+
+/* Start the bots once the server world is up */
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FSStartNetBudgetLoadTestCommand, FAutomationTestBase*, Test);
+
+bool FSStartNetBudgetLoadTestCommand::Update()
+{
+	UWorld* ServerWorld = FindServerWorld();
+	USLoadTestSubsystem* LoadTest = ServerWorld ? ServerWorld->GetSubsystem<USLoadTestSubsystem>() : nullptr;
+	USNetStatsSubsystem* NetStats = ServerWorld ? ServerWorld->GetSubsystem<USNetStatsSubsystem>() : nullptr;
+
+	if (!LoadTest || !NetStats)
+	{
+		Test->AddError(TEXT("PIE did not start a server world with load test and net stats subsystems"));
+		return true;
+	}
+
+	// Only the fight counts against the budget, not the clients joining
+	NetStats->ResetSamples();
+
+	// Stopped by the check, so the report covers exactly the sampled time
+	LoadTest->StartLoadTest(NetBudgetTestBots, 0.0f);
+	Test->TestTrue(TEXT("Load test started"), LoadTest->IsRunning());
+	return true;
+}
+
+/* Fail if any player was sent more than the budget while the bots fought */
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FSCheckNetBudgetCommand, FAutomationTestBase*, Test);
+
+bool FSCheckNetBudgetCommand::Update()
+{
+	UWorld* ServerWorld = FindServerWorld();
+	USNetStatsSubsystem* NetStats = ServerWorld ? ServerWorld->GetSubsystem<USNetStatsSubsystem>() : nullptr;
+
+	if (!NetStats)
+	{
+		Test->AddError(TEXT("The server world has no net stats subsystem"));
+		return true;
+	}
+
+	if (USLoadTestSubsystem* LoadTest = ServerWorld->GetSubsystem<USLoadTestSubsystem>())
+	{
+		LoadTest->StopLoadTest();
+	}
+
+	Test->AddInfo(FString::Printf(TEXT("Peak player bandwidth %d bytes/s, budget %d bytes/s"), NetStats->GetPeakPlayerBytesPerSecond(), USNetStatsSubsystem::GetBudgetBytesPerPlayer()));
+
+	// Nothing sampled means no client connected, which would pass the budget without testing anything
+	Test->TestTrue(TEXT("Player bandwidth was sampled"), NetStats->GetPeakPlayerBytesPerSecond() > 0);
+	Test->TestEqual(TEXT("Samples with a player over the budget"), NetStats->GetNumOverBudgetSamples(), 0);
+	return true;
+}
+
+/* Put the play settings back the way the user had them */
+DEFINE_LATENT_AUTOMATION_COMMAND_TWO_PARAMETER(FSRestorePlaySettingsCommand, EPlayNetMode, PlayNetMode, int32, PlayNumberOfClients);
+
+bool FSRestorePlaySettingsCommand::Update()
+{
+	ULevelEditorPlaySettings* PlaySettings = GetMutableDefault<ULevelEditorPlaySettings>();
+	PlaySettings->SetPlayNetMode(PlayNetMode);
+	PlaySettings->SetPlayNumberOfClients(PlayNumberOfClients);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSNetBudgetTest, "CoopShooter.Net.PlayerBudget",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::StressFilter)
+
+/**
+ * Plays the open map on a dedicated server with connected clients, has load test bots fight on it and fails if any
+ * player is sent more than COOP.Net.BudgetBytesPerPlayer. Runs headless, e.g.
+ * UE4Editor-Cmd CoopShooter MapName -ExecCmds="Automation RunTests CoopShooter.Net.PlayerBudget; Quit" -unattended -nullrhi
+ */
+bool FSNetBudgetTest::RunTest(const FString& Parameters)
+{
+	ULevelEditorPlaySettings* PlaySettings = GetMutableDefault<ULevelEditorPlaySettings>();
+
+	EPlayNetMode OldPlayNetMode = PIE_Standalone;
+	PlaySettings->GetPlayNetMode(OldPlayNetMode);
+	int32 OldPlayNumberOfClients = 1;
+	PlaySettings->GetPlayNumberOfClients(OldPlayNumberOfClients);
+
+	// Play as client runs a dedicated server in the editor process
+	PlaySettings->SetPlayNetMode(PIE_Client);
+	PlaySettings->SetPlayNumberOfClients(FMath::Max(NetBudgetTestClients, 1));
+
+	ADD_LATENT_AUTOMATION_COMMAND(FStartPIECommand(false));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(5.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FSStartNetBudgetLoadTestCommand(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(FMath::Max(NetBudgetTestDuration, 2.0f)));
+	ADD_LATENT_AUTOMATION_COMMAND(FSCheckNetBudgetCommand(this));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FSRestorePlaySettingsCommand(OldPlayNetMode, OldPlayNumberOfClients));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "SBotController.generated.h"
+
+class ASCharacter;
+
+/**
+ * Scripted controller used by the load test.
+ * Wanders without needing a nav mesh and keeps crouching, aiming and firing through the same character functions as player input.
+ */
+UCLASS()
+class COOPSHOOTER_API ASBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+
+	ASBotController();
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+
+	/** How long the bot keeps the same direction and stance, a random time between the two is picked each time */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float MinActionTime;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot")
+	float MaxActionTime;
+
+	/** Chance of crouching and aiming each time the bot changes action */
+	UPROPERTY(EditDefaultsOnly, Category = "Bot", meta = (ClampMin = 0, ClampMax = 1))
+	float CrouchChance;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Bot", meta = (ClampMin = 0, ClampMax = 1))
+	float ADSChance;
+
+private:
+
+	/** Pick a new direction and stance and restart firing */
+	void ChangeAction();
+
+	ASCharacter* BotCharacter;
+
+	FVector WanderDirection;
+	float AimPitch;
+
+	FTimerHandle TimerHandle_ChangeAction;
+};
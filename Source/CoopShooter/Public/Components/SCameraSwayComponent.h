@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SCameraSwayComponent.generated.h"
+
+class UCameraShake;
+class APlayerController;
+class APlayerCameraManager;
+
+enum class ECameraSwayState : uint8
+{
+	None,
+	Idle,
+	MovingForward,
+	MovingRight
+};
+
+/**
+ * Plays the idle and movement camera sway for the locally controlled pawn.
+ * Shakes are only started when the movement state changes and are played on the local camera manager, never through an RPC.
+ */
+UCLASS( ClassGroup=(COOP), meta=(BlueprintSpawnableComponent) )
+class COOPSHOOTER_API USCameraSwayComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	USCameraSwayComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Set the shakes played for each state */
+	void SetCameraShakes(TSubclassOf<UCameraShake> InIdleShake, TSubclassOf<UCameraShake> InForwardShake, TSubclassOf<UCameraShake> InRightShake);
+
+	/** Only enable on the pawn the local player controls, disabling stops any playing sway */
+	void SetSwayEnabled(bool bEnabled);
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Below this speed the owner is treated as idle */
+	UPROPERTY(EditDefaultsOnly, Category = "Camera")
+	float IdleSpeedThreshold;
+
+private:
+
+	ECameraSwayState GetDesiredState() const;
+
+	void EnterState(ECameraSwayState NewState);
+
+	void StopCurrentShake();
+
+	TSubclassOf<UCameraShake> GetShakeForState(ECameraSwayState InState) const;
+
+	APlayerController* GetLocalPlayerController() const;
+
+	ECameraSwayState State;
+
+	UPROPERTY()
+	TSubclassOf<UCameraShake> IdleShake;
+
+	UPROPERTY()
+	TSubclassOf<UCameraShake> ForwardShake;
+
+	UPROPERTY()
+	TSubclassOf<UCameraShake> RightShake;
+
+	/** The shake playing for the current state */
+	UPROPERTY()
+	UCameraShake* CurrentShake;
+
+	/** The camera CurrentShake is playing on, kept so it can still be stopped once the pawn is unpossessed */
+	TWeakObjectPtr<APlayerCameraManager> CurrentCameraManager;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "SCharacterMovementComponent.generated.h"
+
+/**
+ * Character movement that knows about aiming and sprinting.
+ * Both are sent to the server in the compressed flags of every move, next to the engines own crouch flag,
+ * so the server moves the character with the same speed the client predicted and never needs an extra RPC.
+ */
+UCLASS()
+class COOPSHOOTER_API USCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	USCharacterMovementComponent();
+
+	virtual float GetMaxSpeed() const override;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	/** Set on the owning client by input, on the server from the moves it receives */
+	uint8 bWantsToAim : 1;
+
+	uint8 bWantsToSprint : 1;
+
+protected:
+
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+
+	/** Walk speed is scaled by this while aiming down sight */
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement: Walking", meta = (ClampMin = 0.1, ClampMax = 1))
+	float AimSpeedMultiplier;
+
+	/** Walk speed is scaled by this while sprinting, aiming takes priority */
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement: Walking", meta = (ClampMin = 1, ClampMax = 3))
+	float SprintSpeedMultiplier;
+};
+
+/* A saved move that also remembers if the character was aiming or sprinting */
+class FSSavedMove_Character : public FSavedMove_Character
+{
+public:
+
+	typedef FSavedMove_Character Super;
+
+	/** The custom flags used, the engine keeps the others for jump and crouch */
+	enum
+	{
+		FLAG_Aiming = FLAG_Custom_0,
+		FLAG_Sprinting = FLAG_Custom_1,
+	};
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+
+	uint8 bSavedWantsToAim : 1;
+	uint8 bSavedWantsToSprint : 1;
+};
+
+/* Makes the client save FSSavedMove_Character moves */
+class FSNetworkPredictionData_Client_Character : public FNetworkPredictionData_Client_Character
+{
+public:
+
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FSNetworkPredictionData_Client_Character(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
@@ -9,6 +9,33 @@
 // On health changed event
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_SixParams(FOnHealthChangedSignature, USHealthComponent*, HealthComponent, float, Health, float, HealthDelta, const class UDamageType*, DamageType, class AController*, InstigatedBy, AActor*, DamageCauser);
 
+// The same event for native code, which does not need to go through reflection
+DECLARE_MULTICAST_DELEGATE_SixParams(FOnHealthChangedNativeSignature, USHealthComponent*, float, float, const class UDamageType*, class AController*, AActor*);
+
+/**
+ * Health as of the last damage or heal and how it regenerates from there.
+ * Only changes when something happens to the health, the regenerated health is worked out from it when asked for.
+ */
+USTRUCT(BlueprintType)
+struct FSHealthState
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Health right after the last change */
+	UPROPERTY()
+	float BaseHealth = 0.0f;
+
+	/** Server world time regeneration starts at */
+	UPROPERTY()
+	float RegenStartServerTime = 0.0f;
+
+	/** Health per second regenerated from RegenStartServerTime, zero once dead */
+	UPROPERTY()
+	float RegenRate = 0.0f;
+};
+
 UCLASS( ClassGroup=(COOP), meta=(BlueprintSpawnableComponent) )
 class COOPSHOOTER_API USHealthComponent : public UActorComponent
 {
@@ -22,20 +49,53 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
-	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Health Component")
-	float Health;
+	UPROPERTY(ReplicatedUsing = OnRep_HealthState)
+	FSHealthState HealthState;
+
+	/** Broadcast health changes on clients too, so cosmetics can follow the replicated health */
+	UFUNCTION()
+	void OnRep_HealthState(const FSHealthState& OldHealthState);
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Health Component")
 	float DefaultHealth;
 
+	/** Seconds after taking damage before health starts to regenerate */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Health Component")
+	float RegenDelay;
+
+	/** Health regenerated per second */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Health Component")
+	float RegenRate;
+
+	/** The health a state works out to at a server time */
+	float GetHealthAt(const FSHealthState& State, float ServerTime) const;
+
+	/** The servers world time, clients use their synced estimate of it */
+	float GetServerWorldTimeSeconds() const;
+
 	UFUNCTION()
 	void HandleTakeAnyDamage(AActor* DamagedActor, float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
 
+	/** Tell native listeners first, then blueprints */
+	void BroadcastHealthChanged(float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
+
 public:
-	void GiveHealth(float Health);
+	void GiveHealth(float Amount);
+
+	/** Take damage on the server, used by the damage queue and by anything that goes through TakeDamage */
+	void ApplyDamage(float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
+
+	/** The current health including anything regenerated since the last change, the same on server and clients */
+	UFUNCTION(BlueprintPure, Category = "Health Component")
+	float GetHealth() const;
+
+	/** True while health is going up on its own, nothing is broadcast while it does */
+	bool IsRegenerating() const;
 
 public:
 
 	UPROPERTY(BlueprintAssignable, Category = "Events")
 	FOnHealthChangedSignature OnHealthChanged;
+
+	FOnHealthChangedNativeSignature OnHealthChangedNative;
 };
@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "SInventoryComponent.generated.h"
+
+class ASWeapon;
+class UStaticMeshComponent;
+class USInventoryComponent;
+
+/**
+ * A weapon the owner carries. Only a record, the equipped weapon is the only one with an actor.
+ * The weapons have no ammo or attachments yet, anything like that which has to survive a swap belongs here.
+ */
+USTRUCT()
+struct FSInventoryItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TSubclassOf<ASWeapon> WeaponClass;
+
+	/** Stays the same while the item is in the inventory, the array order can differ between server and clients */
+	UPROPERTY()
+	uint8 Slot = 0;
+
+	void PreReplicatedRemove(const struct FSInventoryList& InArraySerializer);
+	void PostReplicatedAdd(const struct FSInventoryList& InArraySerializer);
+	void PostReplicatedChange(const struct FSInventoryList& InArraySerializer);
+};
+
+/* Every weapon the owner carries, only the items that changed are sent */
+USTRUCT()
+struct FSInventoryList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TArray<FSInventoryItem> Items;
+
+	/** Told when the items change on clients */
+	UPROPERTY(NotReplicated)
+	USInventoryComponent* OwnerComponent = nullptr;
+
+	const FSInventoryItem* FindItem(uint8 Slot) const;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FSInventoryList> : public TStructOpsTypeTraitsBase2<FSInventoryList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * The weapons a character carries.
+ * Only the equipped weapon is an actor, taken from the weapon pool when equipped and put back when swapped out.
+ * The next weapon is shown holstered as a static mesh on every machine but a dedicated server.
+ */
+UCLASS( ClassGroup=(COOP), meta=(BlueprintSpawnableComponent) )
+class COOPSHOOTER_API USInventoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	USInventoryComponent();
+
+	/** Add a weapon on the server, it is not equipped. Returns the slot it went in */
+	int32 AddWeapon(TSubclassOf<ASWeapon> WeaponClass);
+
+	/** Swap to the weapon in a slot on the server */
+	void EquipWeapon(uint8 Slot);
+
+	/** Swap to the next weapon, can be called on the owning client */
+	void EquipNextWeapon();
+
+	/** Take the equipped weapon out of the inventory, its actor goes back in the pool */
+	void RemoveEquippedWeapon();
+
+	ASWeapon* GetEquippedWeapon() const { return EquippedWeapon; }
+
+	int32 GetNumWeapons() const { return Inventory.Items.Num(); }
+
+	bool HasWeapon(TSubclassOf<ASWeapon> WeaponClass) const;
+
+	/** Show the weapon that would be equipped next on the owners back, or nothing */
+	void UpdateHolsterProxy();
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerEquipNextWeapon();
+
+	/** The slot after the equipped one, wrapping around, or INDEX_NONE if there is no other weapon */
+	int32 GetNextSlot() const;
+
+	/** Put the equipped weapon back in the pool */
+	void ReleaseEquippedWeapon();
+
+	UPROPERTY(Replicated)
+	FSInventoryList Inventory;
+
+	UPROPERTY(Replicated)
+	ASWeapon* EquippedWeapon;
+
+	/** Zero while nothing is equipped */
+	UPROPERTY(ReplicatedUsing = OnRep_EquippedSlot)
+	uint8 EquippedSlot;
+
+	UFUNCTION()
+	void OnRep_EquippedSlot();
+
+	/** Slot given to the next weapon added, starts at one */
+	uint8 NextFreeSlot;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Inventory")
+	FName EquippedSocketName;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Inventory")
+	FName HolsterSocketName;
+
+	/** Created the first time there is something to holster, never on a dedicated server */
+	UPROPERTY(Transient)
+	UStaticMeshComponent* HolsterProxy;
+
+	/** Holster meshes already streamed or being streamed, so a missing one is not requested over and over */
+	TSet<FSoftObjectPath> RequestedHolsterMeshes;
+};
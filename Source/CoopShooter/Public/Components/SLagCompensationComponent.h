@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SLagCompensationComponent.generated.h"
+
+class USkeletalMeshComponent;
+
+/* A single capsule hitbox that follows the bones of the owners skeletal mesh */
+USTRUCT()
+struct FSHitboxDefinition
+{
+	GENERATED_BODY()
+
+public:
+
+	/** The bone the capsule starts at */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FName BoneName;
+
+	/** The bone the capsule ends at, if none the hitbox is a sphere around BoneName */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FName EndBoneName;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	float Radius;
+
+	/** The surface reported when this hitbox is hit, used to pick damage and impact effects */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	FSHitboxDefinition()
+		: Radius(10.0f)
+		, SurfaceType(SurfaceType_Default)
+	{
+	}
+
+	FSHitboxDefinition(FName InBoneName, FName InEndBoneName, float InRadius, EPhysicalSurface InSurfaceType)
+		: BoneName(InBoneName)
+		, EndBoneName(InEndBoneName)
+		, Radius(InRadius)
+		, SurfaceType(InSurfaceType)
+	{
+	}
+};
+
+/* The pose of every hitbox at a single point in time */
+struct FSHitboxFrame
+{
+	static const int32 MaxHitboxes = 16;
+
+	float Time;
+
+	/** Sphere that bounds all the hitboxes, used to reject a frame early */
+	FVector BoundsCenter;
+	float BoundsRadius;
+
+	FVector Start[MaxHitboxes];
+	FVector End[MaxHitboxes];
+};
+
+/**
+ * Records the hitbox poses of the owner every tick into a fixed size ring buffer,
+ * so that shots from lagged clients can be traced against where the owner was when the client fired.
+ * The newest frame is also what every shot is traced against when it is not rewound, on clients too.
+ */
+UCLASS( ClassGroup=(COOP), meta=(BlueprintSpawnableComponent) )
+class COOPSHOOTER_API USLagCompensationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	USLagCompensationComponent();
+
+	/** 32 frames covers half a second of history even at a 60hz server tick */
+	static const int32 MaxHistoryFrames = 32;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Trace a segment against the hitboxes as they were at Time, returns true on a hit */
+	bool TraceRewound(const FVector& TraceStart, const FVector& TraceEnd, float Time, FHitResult& OutHit, EPhysicalSurface& OutSurfaceType) const;
+
+	/** The time of the oldest recorded frame, or -1 if nothing has been recorded */
+	float GetOldestRecordedTime() const;
+
+	/** Stop recording and take the owner out of every trace, e.g. once it has died. The history is dropped */
+	void StopRecording();
+
+	/** The most recently recorded frame, null if nothing has been recorded */
+	const FSHitboxFrame* GetNewestFrame() const;
+
+	/** True while the owners mesh is simulating physics, its hitboxes then no longer follow an animated pose */
+	bool IsRagdolled() const;
+
+	int32 GetNumHitboxes() const { return NumHitboxes; }
+	float GetHitboxRadius(int32 Index) const { return Radii[Index]; }
+	EPhysicalSurface GetHitboxSurfaceType(int32 Index) const { return SurfaceTypes[Index]; }
+
+	/** Build the hit result for a trace that hit one of our hitboxes */
+	FHitResult MakeHitResult(int32 HitboxIndex, const FVector& TraceStart, const FVector& TraceEnd, const FVector& Impact, const FVector& Normal, float Distance) const;
+
+	/**
+	 * Find where a segment first enters any of a set of capsules, given as separate arrays.
+	 * Returns false if none are hit, otherwise the index of the closest capsule and where it was entered.
+	 */
+	static bool TraceCapsules(const FVector& TraceStart, const FVector& TraceEnd, const FVector* Starts, const FVector* Ends, const float* CapsuleRadii, int32 NumCapsules,
+		int32& OutIndex, float& OutDistance, FVector& OutImpact, FVector& OutNormal);
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** The hitboxes that will be recorded, anything past MaxHitboxes is ignored */
+	UPROPERTY(EditDefaultsOnly, Category = "Lag Compensation")
+	TArray<FSHitboxDefinition> Hitboxes;
+
+private:
+
+	void RecordFrame(float Time);
+
+	/** Build the pose at Time by interpolating between the two recorded frames around it */
+	bool GetRewoundFrame(float Time, FSHitboxFrame& OutFrame) const;
+
+	void DrawRewoundFrame(const FSHitboxFrame& Frame, const FColor& Color) const;
+
+	FSHitboxFrame History[MaxHistoryFrames];
+
+	/** Index the next frame will be written to */
+	int32 HistoryHead;
+	int32 HistoryCount;
+
+	/* Cached from the definitions on begin play so recording does no name lookups */
+	int32 NumHitboxes;
+	int32 StartBoneIndices[FSHitboxFrame::MaxHitboxes];
+	int32 EndBoneIndices[FSHitboxFrame::MaxHitboxes];
+	float Radii[FSHitboxFrame::MaxHitboxes];
+	TEnumAsByte<EPhysicalSurface> SurfaceTypes[FSHitboxFrame::MaxHitboxes];
+
+	UPROPERTY()
+	USkeletalMeshComponent* MeshComponent;
+};
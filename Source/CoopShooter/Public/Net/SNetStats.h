@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("CoopShooterNet"), STATGROUP_CoopShooterNet, STATCAT_Advanced);
+
+class UNetConnection;
+
+/* Total count and size of one kind of network traffic */
+struct FSNetStatsEntry
+{
+	int64 Count = 0;
+	int64 Bits = 0;
+};
+
+/**
+ * Counts what CoopShooter sends over the wire, by RPC and by replicated property.
+ * RPC sizes are the size of the serialized parameters, property sizes are measured in the custom serializers.
+ * Anything the engine serializes for us (movement, plain properties) only shows up in the per connection totals.
+ */
+class COOPSHOOTER_API FSNetStats
+{
+public:
+
+	/** An RPC was sent, Bits is the size of its parameters */
+	static void RecordRPC(FName OwnerClass, FName FunctionName, int64 Bits);
+
+	/** A replicated property was serialized, Bits is the size it was written with */
+	static void RecordProperty(FName OwnerClass, FName PropertyName, int64 Bits);
+
+	/** Per player bandwidth sampled from a server connection */
+	static void RecordConnectionSample(const FString& ConnectionName, int32 BytesPerSecond, bool bOverBudget);
+
+	static void Reset();
+
+	/** Write everything recorded since the last reset, returns false if the file could not be written */
+	static bool WriteCSV(const FString& Filename, float Duration);
+
+	/** Print everything recorded since the last reset to the log */
+	static void Dump(float Duration);
+
+private:
+
+	/* Bandwidth samples for a single connection */
+	struct FConnectionStats
+	{
+		int64 NumSamples = 0;
+		int64 TotalBytesPerSecond = 0;
+		int32 PeakBytesPerSecond = 0;
+		int32 NumOverBudget = 0;
+	};
+
+	static TMap<TPair<FName, FName>, FSNetStatsEntry> RPCs;
+	static TMap<TPair<FName, FName>, FSNetStatsEntry> Properties;
+	static TMap<FString, FConnectionStats> Connections;
+};
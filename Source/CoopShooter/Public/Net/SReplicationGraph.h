@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "SReplicationGraph.generated.h"
+
+class ASCharacter;
+class ASWeapon;
+class UNetDriver;
+struct FURL;
+
+/* How the actors of a class are routed to the graph nodes */
+enum class EClassRepNodeMapping : uint8
+{
+	/** Not routed to a node, replicated through something else (an owning character or connection) */
+	NotRouted,
+	/** Replicated to every connection */
+	RelevantAllConnections,
+	/** Spatialized in the grid but never expected to move */
+	Spatialize_Static,
+	/** Spatialized in the grid and updated every frame */
+	Spatialize_Dynamic,
+	/** Spatialized in the grid, treated as static while dormant */
+	Spatialize_Dormancy,
+};
+
+/**
+ * Replication graph for CoopShooter.
+ * Characters are spatialized on a 2D grid, their weapons replicate as dependents of the character that owns them
+ * and dropped pickups sit in the grid as dormancy aware actors.
+ */
+UCLASS(transient)
+class COOPSHOOTER_API USReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	USReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	/** Replicate the weapons with the character that owns them, called on the server when a weapon is given or taken away. A taken weapon has its channels closed */
+	void OnCharacterWeaponChanged(ASCharacter* Character, ASWeapon* NewWeapon, ASWeapon* OldWeapon);
+
+	/** Returns the graph used by the worlds net driver, if there is one */
+	static USReplicationGraph* Get(const UWorld* World);
+
+	/** Bound to UReplicationDriver::CreateReplicationDriverDelegate by the module */
+	static UReplicationDriver* CreateReplicationDriver(UNetDriver* ForNetDriver, const FURL& URL, UWorld* World);
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+private:
+
+	EClassRepNodeMapping GetMappingPolicy(UClass* Class) const;
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+};
+
+/**
+ * Always replicates the connections player controller and view target
+ */
+UCLASS()
+class COOPSHOOTER_API USReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode_AlwaysRelevant_ForConnection
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+};
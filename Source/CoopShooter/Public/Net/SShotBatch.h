@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "SShotBatch.generated.h"
+
+/* A single shot fired by a client, sent to the server as part of a FSShotBatch */
+USTRUCT()
+struct FSShotRecord
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Increases by one for every shot the weapon fires, used by the server to drop duplicates */
+	UPROPERTY()
+	uint16 Sequence;
+
+	/** Where the shot was traced from */
+	UPROPERTY()
+	FVector Origin;
+
+	/** Aim of the shot, sent as two compressed axes */
+	UPROPERTY()
+	FRotator AimRotation;
+
+	/** The clients estimate of the server time the shot was fired at */
+	UPROPERTY()
+	float Timestamp;
+
+	FSShotRecord()
+		: Sequence(0)
+		, Origin(ForceInitToZero)
+		, AimRotation(ForceInitToZero)
+		, Timestamp(0.0f)
+	{
+	}
+};
+
+/**
+ * Every shot a client fired during a single frame, plus a few of the previous ones so an unreliable send can be lost.
+ * Shots in a batch always have consecutive sequence numbers so only the first is sent.
+ */
+USTRUCT()
+struct FSShotBatch
+{
+	GENERATED_BODY()
+
+public:
+
+	static const int32 MaxShots = 16;
+
+	UPROPERTY()
+	TArray<FSShotRecord> Shots;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FSShotBatch> : public TStructOpsTypeTraitsBase2<FSShotBatch>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/* The servers verdict on a single shot, a hit means it damaged a pawn */
+USTRUCT()
+struct FSShotAck
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	uint16 Sequence;
+
+	UPROPERTY()
+	bool bHit;
+
+	FSShotAck()
+		: Sequence(0)
+		, bHit(false)
+	{
+	}
+};
+
+/**
+ * Every shot the server processed for a client during a single frame.
+ * Consecutive sequences cost a single bit each so a typical ack is two bits per shot.
+ */
+USTRUCT()
+struct FSShotAckBatch
+{
+	GENERATED_BODY()
+
+public:
+
+	static const int32 MaxAcks = 32;
+
+	UPROPERTY()
+	TArray<FSShotAck> Acks;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FSShotAckBatch> : public TStructOpsTypeTraitsBase2<FSShotAckBatch>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * The weapon and health rules, kept free of the engine so they can be built and checked on their own.
+ * Only plain floats go in and out, ASWeapon and USHealthComponent call these instead of doing the math themselves.
+ */
+namespace SGameplayRules
+{
+	inline float Min(float A, float B) { return A < B ? A : B; }
+	inline float Max(float A, float B) { return A > B ? A : B; }
+	inline float Clamp(float Value, float MinValue, float MaxValue) { return Max(MinValue, Min(Value, MaxValue)); }
+
+	/** Seconds between shots for a rate of fire in rounds per minute, zero if the weapon cannot fire */
+	inline float GetTimeBetweenShots(float RateOfFire)
+	{
+		return RateOfFire > 0.0f ? 60.0f / RateOfFire : 0.0f;
+	}
+
+	/** When the first shot of a burst is due, pressing fire again cannot beat the rate of fire */
+	inline float GetFirstShotTime(float LastShotTime, float TimeBetweenShots, float Now)
+	{
+		return Max(LastShotTime + TimeBetweenShots, Now);
+	}
+
+	/** The damage a hit does, vulnerable surfaces take the crit damage */
+	inline float GetHitDamage(float BaseDamage, float CritDamage, bool bVulnerableSurface)
+	{
+		return bVulnerableSurface ? CritDamage : BaseDamage;
+	}
+
+	/** Health after taking damage, never below zero or above the maximum */
+	inline float ApplyDamage(float Health, float Damage, float MaxHealth)
+	{
+		return Clamp(Health - Damage, 0.0f, MaxHealth);
+	}
+
+	/** Health after a heal, dead stays dead */
+	inline float GiveHealth(float Health, float Amount, float MaxHealth)
+	{
+		if (Health <= 0.0f || Amount <= 0.0f)
+			return Health;
+
+		return Min(Health + Amount, Max(MaxHealth, Health));
+	}
+
+	/** Health regenerated from BaseHealth since RegenStartTime, dead stays dead and a heal above the maximum is kept */
+	inline float GetRegeneratedHealth(float BaseHealth, float RegenStartTime, float RegenRate, float MaxHealth, float Now)
+	{
+		if (BaseHealth <= 0.0f || Now <= RegenStartTime)
+			return BaseHealth;
+
+		return Min(BaseHealth + (Now - RegenStartTime) * RegenRate, Max(MaxHealth, BaseHealth));
+	}
+}
@@ -12,6 +12,10 @@ class ASWeapon;
 class UCameraShake;
 class USHealthComponent;
 class UPostProcessComponent;
+class USLagCompensationComponent;
+class USCameraSwayComponent;
+class USCharacterMovementComponent;
+class USInventoryComponent;
 
 enum class EViewportEnum : uint8
 {
@@ -26,7 +30,7 @@ class COOPSHOOTER_API ASCharacter : public ACharacter
 
 public:
 	// Sets default values for this character's properties
-	ASCharacter();
+	ASCharacter(const FObjectInitializer& ObjectInitializer);
 
 protected:
 	// Called when the game starts or when spawned
@@ -38,62 +42,55 @@ protected:
 	/** Move the player right */
 	void MoveRight(float Val);
 
-	/** Called when starting to crouch */
-	void BeginCrouch();
-
-	/** Called when ending crouch */
-	void EndCrouch();
-
 	/** Called when switching the viewport */
 	void SwitchViewport();
 
-	/** Start aiming down sight */
-	void BeginADS();
-
-	/** End aiming down sight */
-	void EndADS();
-
-	UPROPERTY(Replicated)
-	ASWeapon* CurrentWeapon;
-
-	UPROPERTY(Replicated)
-	ASWeapon* HolsteredWeapon;
-
+	/** Put in the inventory on spawn, the starter weapon is equipped */
 	UPROPERTY(EditDefaultsOnly, Category = "Player")
-	TSubclassOf<ASWeapon> StarterWeaponClass;
+	TSoftClassPtr<ASWeapon> StarterWeaponClass;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Player")
-	TSubclassOf<ASWeapon> HolsteredWeaponClass;
-
-	UPROPERTY(VisibleDefaultsOnly, Category = "Player")
-	FName WeaponAttachSocketName;
+	TSoftClassPtr<ASWeapon> HolsteredWeaponClass;
 
-	UPROPERTY(VisibleDefaultsOnly, Category = "Player")
-	FName RifleHolsterName;
-
-	void StartFire();
+	/** The weapons the player carries, only the equipped one is an actor */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	USInventoryComponent* InventoryComponent;
 
-	void EndFire();
+	/** Swap to the next weapon in the inventory */
+	void SwitchWeapon();
 
-	/** Called when the player takes damage? */
+	/** Called when the player takes damage, on clients when the replicated health changes */
 	UFUNCTION()
 	void OnHealthChanged(USHealthComponent* HealthComponent, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
 
-	/** The camera atttached to the player */
+	/** The camera atttached to the player, like the spring arm, camera sway and post fx it is destroyed on a dedicated server */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly , Category = "Components")
 	UCameraComponent* CameraComponent;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	USpringArmComponent* SpringArmComponent;
 
+	/** Only ever set on the locally controlled player, so other characters never tint the view */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	UPostProcessComponent* PostProcessComponent;
-	FPostProcessSettings PostFXDamage;
 
+	/** Desaturate the screen as the player loses health */
+	void UpdateDamagePostFX(float Health);
+
+	/** Free the components only used to view through the character */
+	void DestroyCosmeticComponents();
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	USHealthComponent* HealthComponentProtected;
 
+	/** Records the hitbox history the server rewinds when processing shots from lagged clients */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	USLagCompensationComponent* LagCompensationComponent;
+
+	/** Plays the idle and movement camera sway, only active on the locally controlled character */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	USCameraSwayComponent* CameraSwayComponent;
+
 	/** The offset of the camera, used when switching between left and right */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Camera")
 	float CameraViewportOffset;
@@ -122,9 +119,11 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Camera")
 	TSubclassOf<UCameraShake> IdleCamSway;
 
-	/** Turns the player charcter into a ragdoll*/
+	/** Turns the player charcter into a ragdoll, simulated by the corpse subsystem on clients only */
 	void BeginRagdoll();
 	void ActivateRagdoll();
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	/** After death detatch  the weapon from the players hands */
 	void DetatchWeapon();
 
@@ -137,40 +136,89 @@ public:
 
 	virtual FVector GetPawnViewLocation() const override;
 
+	virtual void PawnClientRestart() override;
+
+	virtual void UnPossessed() override;
+
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
+
+	/** Called when starting to crouch */
+	void BeginCrouch();
+
+	/** Called when ending crouch */
+	void EndCrouch();
+
+	/** Start aiming down sight */
+	void BeginADS();
+
+	/** End aiming down sight */
+	void EndADS();
+
+	/** Start sprinting, aiming down sight or crouching cancel it out */
+	void BeginSprint();
+
+	void EndSprint();
+
+	/** True while aiming down sight, on simulated proxies this is what the server last replicated */
+	UFUNCTION(BlueprintPure, Category = "Player")
+	bool IsAiming() const;
+
+	/** Pass the aim the owner sent with its moves on to everyone else */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/** Input and bots both fire the current weapon through these */
+	void StartFire();
+
+	void EndFire();
+
+	ASWeapon* GetCurrentWeapon() const;
+
+	USInventoryComponent* GetInventoryComponent() const { return InventoryComponent; }
+
+	bool IsDead() const { return bIsDead; }
+
 private:
 
 	//UPROPERTY(EditAnywhere, Category = "ViewPort")
 	EViewportEnum ViewPort;
 
-	bool bADS;
+	/** Aiming and sprinting are sent to the server with the moves of the owning client */
+	USCharacterMovementComponent* SCharacterMovement;
 
-	/** Handles updating of the ADS mechanic */
-	void ADSCheck(float DeltaTime);
+	/** The aim state for simulated proxies, the owner and the server read it from the movement component */
+	UPROPERTY(Replicated)
+	bool bIsAiming;
+
+	/** Handles updating of the ADS mechanic, returns true until the FOV reaches its target */
+	bool ADSCheck(float DeltaTime);
+
+	/** Turns the camera to look at the ragdoll, returns true until it is looking at it and the ragdoll is at rest */
+	bool UpdateDeadCamera(float DeltaTime);
 
-	void UpdateCameraSway();
 	void SpawnWeapons();
 
+	/** Set once the weapon classes have been requested, so a class that fails to load is not requested forever */
+	bool bRequestedWeaponClasses;
+
+	/** Set once the pickup dropped on death has been requested, so the server never blocks on loading it */
+	bool bRequestedDroppedWeaponClass;
+
 	/** Used when testing some code */
 	void TestFunction();
 	void TakeDamageSimple(float Damage);
 	void Kill();
-	void Heal();
 
-	/** Handle the ragdoll on the cliet and server */
-	UFUNCTION(NetMulticast, Reliable, WithValidation)
-	void NetMulticastBeginRagdoll();
-	virtual bool NetMulticastBeginRagdoll_Validate();
-	virtual void NetMulticastBeginRagdoll_Implementation();
+	/** Start the ragdoll on clients, including ones the character only becomes relevant to after it died */
+	UFUNCTION()
+	void OnRep_IsCharacterRagdoll();
 
 private:
 
-	UPROPERTY(Replicated)
+	UPROPERTY(ReplicatedUsing = OnRep_IsCharacterRagdoll)
 	bool bIsCharacterRagdoll;
 
-	bool bIsCheckingFall;
 	bool bIsDead;
 
 	FTimerHandle TimerHandle_WeaponDetatchTimer;
 	FTimerHandle TimerHandle_FallChecker;
-	FTimerHandle TimerHandle_HealthCharacter;
 };
@@ -5,26 +5,131 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "SWeaponPickup.h"
+#include "Net/SShotBatch.h"
+#include "WorldCollision.h"
 #include "SWeapon.generated.h"
 
 class USkeletalMeshComponent;
 class UDamageType;
 class UParticleSystem;
 class UCameraShake;
-
-/* Contains information of a single hitscan weapon line trace */
+class UParticleSystemComponent;
+class UStaticMesh;
+class ASWeapon;
+
+// Hit marker event, predicted hits are sent straight away and again once the server confirms or rejects them
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnHitMarkerSignature, ASWeapon*, Weapon, bool, bHit, bool, bConfirmedByServer);
+
+/**
+ * Contains information of a single hitscan weapon line trace.
+ * The end of the trace is stored relative to the weapons muzzle, which every machine already knows,
+ * so only a direction and a distance have to be sent instead of a world position.
+ */
 USTRUCT()
-struct FHitScanTrace
+struct FHitScanTrace : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 
 public:
 
+	/** Bits per axis of the octahedral encoded direction, 14 keeps the end within a couple of units at full range */
+	static const int32 DirectionBits = 14;
+
+	/** Bits of the distance, quantized over the trace range */
+	static const int32 DistanceBits = 14;
+
+	/** The weapon trace range, anything further is clamped */
+	static constexpr float MaxDistance = 10000.0f;
+
+	/** The shooters shot sequence, wraps around. Also seeds the pellet spread so clients can regenerate it */
+	UPROPERTY()
+	uint16 ShotIndex;
+
 	UPROPERTY()
 	TEnumAsByte<EPhysicalSurface> SurfaceType;
 
+	/** From the muzzle to the impact point of a single pellet shot, or the aim of a multi pellet shot */
+	UPROPERTY()
+	FVector Direction;
+
+	/** From the muzzle to the impact point, the full trace range if nothing was hit */
 	UPROPERTY()
-	FVector_NetQuantize TraceTo;
+	float Distance;
+
+	/** Where the trace ended, given where the muzzle is on this machine */
+	FVector GetTraceEnd(const FVector& MuzzleLocation) const { return MuzzleLocation + (Direction * Distance); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FHitScanTrace> : public TStructOpsTypeTraitsBase2<FHitScanTrace>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/* The most recent shots fired by a weapon, so every shot between two net updates reaches the clients */
+USTRUCT()
+struct FHitScanTraceArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+public:
+
+	/** How many shots are kept, must cover every shot fired between two net updates */
+	static const int32 MaxTraces = 8;
+
+	UPROPERTY()
+	TArray<FHitScanTrace> Items;
+
+	/** Add a shot, dropping the oldest one if full. The trace is given from the muzzle */
+	void AddTrace(uint16 ShotIndex, const FVector& MuzzleLocation, const FVector& TraceEnd, EPhysicalSurface SurfaceType);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FHitScanTraceArray> : public TStructOpsTypeTraitsBase2<FHitScanTraceArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/* A shot whose trace has been sent to the async trace queue, resolved once the result is back */
+struct FSPendingShot
+{
+	FTraceHandle TraceHandle;
+	FVector EyeLocation;
+	FVector AimDirection;
+	FVector PelletDirection;
+	float RewindTime;
+	uint16 Sequence;
+
+	/** The shot is replicated once its last pellet has been applied */
+	bool bLastPellet;
+
+	/** Characters were left out of the world trace, they are hit through their hitboxes */
+	bool bTraceHitboxes;
+
+	bool bTraceDone;
+	bool bBlockingHit;
+	FHitResult Hit;
+};
+
+/* A shot the owning client predicted, kept until the server acknowledges it */
+struct FSPredictedShot
+{
+	uint16 Sequence;
+	bool bPredictedHit;
+	float FireTime;
+
+	/** The impacts played on pawns for the prediction, stopped if the server says the shot missed */
+	TArray<TPair<TWeakObjectPtr<UParticleSystemComponent>, FVector>, TInlineAllocator<1>> HitImpacts;
 };
 
 UCLASS()
@@ -40,16 +145,38 @@ public:
 
 	void EndFire();
 
+	virtual void Tick(float DeltaTime) override;
+
+	/**
+	 * Fire a single shot, called by the fire scheduler for every shot due this frame.
+	 * ShotAge is how long ago the shot was due, the aim passed in is the aim at that time.
+	 */
+	void Fire(const FVector& EyeLocation, const FRotator& EyeRotation, float ShotAge);
+
+	float GetTimeBetweenShots() const { return TimeBetweenShots; }
+
+	/** Stop firing and forget everything about the last owner, called before the weapon goes back in the pool */
+	void ResetForPool();
+
 protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** The effects are streamed in when the weapon spawns, until then shots play without them */
+	void OnCosmeticAssetsLoaded();
+
 	/** The mesh of the weapon */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	USkeletalMeshComponent* MeshComponent;
 
+	/** Where replicated shots are encoded from, close enough on every machine for the effects */
+	FVector GetMuzzleLocation() const;
+
 	void PlayFireFX(FVector TracerEndPoint);
-	void PlayImpactFX(EPhysicalSurface SurfaceType, FVector ImpactPoint);
+	void PlayTracerFX(FVector TracerEndPoint);
+	UParticleSystemComponent* PlayImpactFX(EPhysicalSurface SurfaceType, FVector ImpactPoint);
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	TSubclassOf<UDamageType> DamageType;
@@ -64,21 +191,21 @@ protected:
 
 	/** The effect that will be displayed at the end of the muzzle when wepon is fired */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
-	UParticleSystem* MuzzleEffect;
+	TSoftObjectPtr<UParticleSystem> MuzzleEffect;
 
 	/** The effect that will be displayed at the point of damage */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
-	UParticleSystem* DefaultImpactEffect;
+	TSoftObjectPtr<UParticleSystem> DefaultImpactEffect;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
-	UParticleSystem* FleshImpactEffect;
+	TSoftObjectPtr<UParticleSystem> FleshImpactEffect;
 
 	/** The effect that will trace the path of each shot fired */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
-	UParticleSystem* TracerEffect;
+	TSoftObjectPtr<UParticleSystem> TracerEffect;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
-	TSubclassOf<UCameraShake> FireCamShake;
+	TSoftClassPtr<UCameraShake> FireCamShake;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
 	float BaseDamage;
@@ -86,9 +213,56 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
 	float CritDamage;
 
-	void Fire();
+	static const int32 MaxPellets = 16;
+
+	/** How many pellets each shot fires, each does the full damage */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 1, ClampMax = 16))
+	int32 PelletCount;
+
+	/** Half angle in degrees of the cone the pellets spread in */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 0, ClampMax = 45))
+	float PelletSpread;
+
+	/** The spread is scaled by this while the owner aims down sight */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 0, ClampMax = 1))
+	float AimSpreadMultiplier;
+
+	/** The same seed gives the same pellets on every machine, so only the seed and the aim are replicated */
+	void GetPelletDirections(const FVector& AimDirection, uint16 Seed, TArray<FVector, TInlineAllocator<MaxPellets>>& OutDirections) const;
+
+	/** Regenerate the pellets of a replicated multi pellet shot and trace them locally for the effects */
+	void PlayPelletFX(const FHitScanTrace& Trace);
+
+	/**
+	 * Trace every pellet of a shot, their damage and effects are applied once the traces are back.
+	 * When RewindTime is positive characters are traced where they were at that server time.
+	 */
+	void FireShot(const FVector& EyeLocation, const FVector& ShotDirection, float RewindTime, uint16 ShotSequence);
+
+	/** Apply the damage and effects of a traced pellet */
+	void ApplyShot(FSPendingShot& Shot);
 
-	FTimerHandle TimerHandle_TimeBetweenShots;
+	/**
+	 * Replace the hit with a hitbox hit if one is closer, returns true if a hitbox was hit.
+	 * When RewindTime is positive the hitboxes are rewound to it, otherwise their newest pose is used.
+	 */
+	bool TraceHitboxes(const FVector& TraceStart, const FVector& TraceEnd, float RewindTime, FHitResult& InOutHit, EPhysicalSurface& OutSurfaceType) const;
+
+	/** Called by the async trace queue the frame after a shot was traced */
+	void OnShotTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	/** Apply every shot whose trace is back in one pass */
+	void ResolveShots();
+
+	/** Shots waiting on their async trace, in the order they were fired */
+	TArray<FSPendingShot> PendingShots;
+
+	FTraceDelegate ShotTraceDelegate;
+
+	/** The clients best guess of the current server time, used to timestamp shots */
+	float GetServerWorldTimeSeconds() const;
+
+	/** World time of the last shot */
 	float TimeSinceLastShot;
 
 	/** Round per minute */
@@ -101,15 +275,87 @@ protected:
 	///////////////////////////////////////////////////////////////////////
 	/* SERVER */
 	UPROPERTY(ReplicatedUsing = OnRep_HitScanTrace)
-	FHitScanTrace HitScanTrace;
+	FHitScanTraceArray HitScanTraces;
 
+	/** Plays the effects of every shot that arrived since the last update, in the order they were fired */
 	UFUNCTION()
 	void OnRep_HitScanTrace();
 
+	/** The newest shot the effects have been played for on this client */
+	uint16 LastPlayedShotIndex;
+	bool bHasPlayedHitScanTrace;
+
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerFire();
+	void ServerFire(FVector_NetQuantize TraceStart, FVector_NetQuantizeNormal ShotDirection, float ClientTimestamp, uint16 ShotSequence);
+
+	/** Every shot fired by the client this frame, unreliable as each batch resends the last few shots */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerFireBatch(const FSShotBatch& Batch);
+
+	/** Trace a shot received from the owning client unless it has been already, used by both ServerFire and ServerFireBatch */
+	void ProcessClientShot(FVector TraceStart, const FVector& ShotDirection, float ClientTimestamp, uint16 ShotSequence);
+
+	/** True in a server RPC that came over the wire, rather than from a listen servers own pawn */
+	bool IsRemoteOwnerRPC() const;
+
+	/** Queue a shot to be sent to the server with the rest of this frames shots */
+	void QueueShot(uint16 Sequence, const FVector& Origin, const FRotator& AimRotation, float Timestamp);
+
+	/** Send every queued shot to the server in a single batch */
+	void FlushShots();
+
+	/** Bound while shots are queued. Runs after every actor and tickable object, so the fire scheduler's shots go out this frame */
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	FDelegateHandle PostActorTickHandle;
+
+	/** The most recent shots, the last NumUnsentShots of which have not been sent yet */
+	TArray<FSShotRecord> ShotHistory;
+	int32 NumUnsentShots;
+
+	/** Sequence of the next shot, seeds its pellets. Shots from a remote owner carry the sequence the client gave them */
+	uint16 NextShotSequence;
+
+	/** Keep the weapon awake while it is firing, it goes back to sleep a short while after the last shot */
+	void WakeFromDormancy();
+
+	/** Put the weapon back to sleep if it has not fired for a while */
+	void CheckDormancy();
+
+	FTimerHandle TimerHandle_Dormancy;
+	float LastServerShotTime;
+
+	/** Record the result of a shot once its last pellet is applied, predicting or acknowledging it */
+	void FinishShot(uint16 Sequence);
+
+	/** The pawn hits of the shot whose pellets are being applied */
+	FSPredictedShot CurrentShot;
+
+	/** Shots the owning client has predicted and the server not yet acknowledged, oldest first */
+	TArray<FSPredictedShot> PredictedShots;
+
+	/** Shots processed this frame for the owning client, sent as one batch at the end of the frame */
+	TArray<FSShotAck> PendingAcks;
+
+	void FlushShotAcks();
+
+	/** Tells the owning client which of its shots hit, so it can confirm or roll back what it predicted */
+	UFUNCTION(Client, Unreliable)
+	void ClientAckShots(const FSShotAckBatch& Batch);
+
+	/** The newest shot the server has processed from the owning client */
+	uint16 LastProcessedShotSequence;
+	bool bHasProcessedShot;
 
 public: 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
-	TSubclassOf<ASWeaponPickup> DroppedWeapon;
+	TSoftClassPtr<ASWeaponPickup> DroppedWeapon;
+
+	/** Shown on the owners back while the weapon is holstered, so a holstered weapon never needs an actor */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+	TSoftObjectPtr<UStaticMesh> HolsterMesh;
+
+	/** Only broadcast on the machine controlling the shooter */
+	UPROPERTY(BlueprintAssignable, Category = "Events")
+	FOnHitMarkerSignature OnHitMarker;
 };
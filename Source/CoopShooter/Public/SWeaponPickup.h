@@ -6,6 +6,13 @@
 #include "GameFramework/Actor.h"
 #include "SWeaponPickup.generated.h"
 
+class ASWeapon;
+class ASCharacter;
+
+/**
+ * A weapon lying in the world. It never ticks or overlaps, the pickup subsystem finds players next to it
+ * and despawns it once it is too old.
+ */
 UCLASS()
 class COOPSHOOTER_API ASWeaponPickup : public AActor
 {
@@ -15,12 +22,16 @@ public:
 	// Sets default values for this actor's properties
 	ASWeaponPickup();
 
+	/** Put the weapon in the characters inventory on the server, returns false if they can not take it */
+	bool GiveTo(ASCharacter* Character);
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	/** The weapon walking over the pickup gives, nothing can pick it up if this is not set */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Pickup")
+	TSoftClassPtr<ASWeapon> WeaponClass;
 };
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "SAssetStreamingSubsystem.generated.h"
+
+/* The assets a map wants loaded before they are first used */
+USTRUCT()
+struct FSPreloadManifest
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Needed by the game, loaded everywhere. Weapon and pickup classes */
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	TArray<FSoftObjectPath> GameplayAssets;
+
+	/** Only seen or heard, never loaded on a dedicated server. Effects and camera shakes */
+	UPROPERTY(EditAnywhere, Category = "Streaming")
+	TArray<FSoftObjectPath> CosmeticAssets;
+};
+
+/**
+ * Async loads soft referenced weapon classes and effects, so nothing is pulled in with the character and nothing hitches when first used.
+ * Each map can preload its assets through a manifest in the [/Script/CoopShooter.SAssetStreamingSubsystem] section of DefaultGame.ini.
+ * Everything loaded stays resident until the world is torn down.
+ */
+UCLASS(config = Game)
+class COOPSHOOTER_API USAssetStreamingSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Async load the assets, OnLoaded is called once they are all in, straight away if they already are.
+	 * Cosmetic requests are dropped on a dedicated server and OnLoaded is never called.
+	 */
+	void RequestLoad(const TArray<FSoftObjectPath>& Assets, bool bCosmetic, FStreamableDelegate OnLoaded = FStreamableDelegate());
+
+	/** False on a dedicated server, which never needs to see or hear anything */
+	bool ShouldLoadCosmetics() const;
+
+protected:
+
+	/** Keyed by map name without the PIE prefix */
+	UPROPERTY(config)
+	TMap<FName, FSPreloadManifest> MapManifests;
+
+private:
+
+	FStreamableManager StreamableManager;
+
+	/** Keeps everything we loaded resident, the handle that first loaded each asset */
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> Handles;
+
+	double PreloadStartTime;
+
+	void OnPreloadComplete();
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SCorpseSubsystem.generated.h"
+
+class ASCharacter;
+
+/* A dead character and where it is in its lifecycle */
+USTRUCT()
+struct FSCorpse
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	ASCharacter* Character = nullptr;
+
+	/** World time the character died */
+	float DeathTime = 0.0f;
+
+	bool bSimulating = false;
+	bool bFrozen = false;
+};
+
+/**
+ * Looks after dead characters.
+ * Clients simulate the ragdolls, up to a cap, and freeze them once they settle so they stop costing physics.
+ * The server never simulates them and destroys corpses once they are too old or there are too many.
+ */
+UCLASS()
+class COOPSHOOTER_API USCorpseSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Called on the server when the character dies and on clients when they hear about it */
+	void AddCorpse(ASCharacter* Character);
+
+	/** Called when the corpse is destroyed */
+	void RemoveCorpse(ASCharacter* Character);
+
+	int32 GetNumSimulatingRagdolls() const;
+
+private:
+
+	bool ShouldSimulateRagdolls() const;
+
+	void StartRagdoll(FSCorpse& Corpse);
+
+	/** Stop simulating but keep the pose the ragdoll came to rest in */
+	void FreezeRagdoll(FSCorpse& Corpse);
+
+	/** Keep the newest ragdolls simulating, freeze the oldest past the cap */
+	void EnforceRagdollCap();
+
+	/** Oldest first */
+	UPROPERTY()
+	TArray<FSCorpse> Corpses;
+};
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SDamageSubsystem.generated.h"
+
+class USHealthComponent;
+class UDamageType;
+class AController;
+
+/**
+ * Damage events queued during a frame, packed into flat arrays.
+ * They can outlive a garbage collection when queued after the subsystem ticked, so objects are held weakly.
+ */
+struct FSDamageQueue
+{
+	TArray<TWeakObjectPtr<USHealthComponent>> Targets;
+	TArray<float> Amounts;
+	TArray<TEnumAsByte<EPhysicalSurface>> SurfaceTypes;
+	TArray<TWeakObjectPtr<AController>> Instigators;
+	TArray<TWeakObjectPtr<AActor>> DamageCausers;
+	TArray<TSubclassOf<UDamageType>> DamageTypes;
+
+	/** Server world time the damage was done at, events are applied oldest first */
+	TArray<float> Timestamps;
+
+	int32 Num() const { return Targets.Num(); }
+
+	void Reset();
+
+	/** Drop the oldest queued events, keeping the memory */
+	void RemoveFirst(int32 Count);
+};
+
+/* The damage a target takes this frame, everything is applied and broadcast at once */
+struct FSResolvedDamage
+{
+	USHealthComponent* Target;
+
+	/** Health before this frames damage */
+	float Health;
+	float Damage;
+
+	/** The event the damage was last added from, its instigator gets the credit */
+	int32 LastEvent;
+};
+
+/**
+ * Applies weapon damage on the server once a frame.
+ * Hits are queued instead of going through ApplyPointDamage and the dynamic OnTakeAnyDamage delegate, the queue is resolved
+ * in one pass and every damaged health component applies its total damage and broadcasts the change once.
+ */
+UCLASS()
+class COOPSHOOTER_API USDamageSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Queue damage to an actor with a health component, returns false if the actor has to be damaged directly instead */
+	bool QueueDamage(AActor* Target, float Amount, EPhysicalSurface SurfaceType, AController* Instigator, AActor* DamageCauser, TSubclassOf<UDamageType> DamageType, float Timestamp);
+
+	/** Apply everything queued so far */
+	void ResolveDamage();
+
+	static bool IsEnabled();
+
+private:
+
+	FSDamageQueue Queue;
+
+	/** Kept between frames so resolving does not allocate */
+	TArray<int32> SortedEvents;
+	TArray<FSResolvedDamage> ResolvedTargets;
+	TMap<USHealthComponent*, int32> TargetSlots;
+};
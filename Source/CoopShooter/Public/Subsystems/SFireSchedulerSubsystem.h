@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SFireSchedulerSubsystem.generated.h"
+
+class ASWeapon;
+
+/* A weapon that is firing and when its next shot is due */
+USTRUCT()
+struct FSScheduledWeapon
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	ASWeapon* Weapon = nullptr;
+
+	/** World time the next shot is due, can fall anywhere inside a frame */
+	float NextShotTime = 0.0f;
+
+	/** The owners aim at the end of the last frame, shots between then and now are interpolated from it */
+	FVector LastEyeLocation = FVector::ZeroVector;
+	FRotator LastEyeRotation = FRotator::ZeroRotator;
+	bool bHasLastAim = false;
+
+	/** Removed at the end of the next tick, so weapons can stop firing while shots are being fired */
+	bool bStopped = false;
+};
+
+/**
+ * Fires every automatic weapon in the world from a single tick instead of a looping timer per weapon.
+ * Each shot keeps the exact time it was due, even when several fall in one frame, and gets the aim
+ * interpolated to that time and a timestamp the server rewinds to.
+ */
+UCLASS()
+class COOPSHOOTER_API USFireSchedulerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Start firing the weapon, the first shot is due at FirstShotTime. Weapons with no time between shots are never scheduled */
+	void StartFiring(ASWeapon* Weapon, float FirstShotTime);
+
+	void StopFiring(ASWeapon* Weapon);
+
+private:
+
+	UPROPERTY()
+	TArray<FSScheduledWeapon> FiringWeapons;
+};
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SLagCompensationSubsystem.generated.h"
+
+class USLagCompensationComponent;
+
+/**
+ * The newest hitboxes of every registered actor packed into flat arrays, rebuilt at most once a frame.
+ * Each actor owns a contiguous range of hitboxes, so a shot tests every character in one linear pass.
+ */
+struct FSHitboxBroadphase
+{
+	/** Per actor */
+	TArray<USLagCompensationComponent*> Components;
+	TArray<const AActor*> Owners;
+	TArray<FVector> BoundsCenters;
+	TArray<float> BoundsRadii;
+	TArray<int32> FirstHitboxes;
+	TArray<int32> NumHitboxes;
+
+	/** Per hitbox */
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	TArray<float> Radii;
+	TArray<TEnumAsByte<EPhysicalSurface>> SurfaceTypes;
+
+	/** The frame the arrays were built on */
+	uint64 BuiltFrame = MAX_uint64;
+
+	void Reset();
+};
+
+/**
+ * Keeps track of every lag compensated actor in the world and traces shots against their hitboxes,
+ * either as they are now or rewound to when a lagged client fired.
+ */
+UCLASS()
+class COOPSHOOTER_API USLagCompensationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void RegisterComponent(USLagCompensationComponent* Component);
+	void UnregisterComponent(USLagCompensationComponent* Component);
+
+	/** Clamp a client timestamp to the rewind window, returns the server time the shot should be traced at */
+	float GetRewindTime(float ClientTimestamp) const;
+
+	/** Trace against the hitboxes of every registered actor as they were at Time, the closest hit is returned */
+	bool RewindTrace(const FVector& TraceStart, const FVector& TraceEnd, float Time, const AActor* IgnoredActor, FHitResult& OutHit, EPhysicalSurface& OutSurfaceType) const;
+
+	/** Trace against the newest hitboxes of every registered actor, the closest hit is returned */
+	bool TraceHitboxes(const FVector& TraceStart, const FVector& TraceEnd, const AActor* IgnoredActor, FHitResult& OutHit, EPhysicalSurface& OutSurfaceType);
+
+	static bool IsEnabled();
+
+	/** When true weapons trace the world with simple collision that ignores characters and find character hits in the hitboxes */
+	static bool IsBroadphaseEnabled();
+
+private:
+
+	/** Pack the newest frame of every component, only does anything the first time it is called in a frame */
+	void UpdateBroadphase();
+
+	FSHitboxBroadphase Broadphase;
+
+	UPROPERTY()
+	TArray<USLagCompensationComponent*> Components;
+};
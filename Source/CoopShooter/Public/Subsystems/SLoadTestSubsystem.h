@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SLoadTestSubsystem.generated.h"
+
+class ASBotController;
+
+/**
+ * Spawns bots on the server and records frame time, game thread time, weapon trace time and memory to a report in Saved/Profiling/LoadTest.
+ * Start it with COOP.LoadTest.Start or from the command line, e.g. a dedicated server or a -nullrhi game run with
+ * -LoadTestBots=32 -LoadTestDuration=120 -LoadTestExit. Emulated lag and loss come from the engines -PktLag= and -PktLoss= options.
+ */
+UCLASS()
+class COOPSHOOTER_API USLoadTestSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Spawn the bots and start recording, a Duration of 0 records until StopLoadTest is called */
+	void StartLoadTest(int32 InNumBots, float InDuration);
+
+	/** Stop recording, destroy the bots and write the report */
+	void StopLoadTest();
+
+	bool IsRunning() const { return bRunning; }
+
+	/** Time spent in and number of synchronous weapon world traces, added to by ASWeapon so it can be reported */
+	static double WeaponTraceSeconds;
+	static int32 NumWeaponTraces;
+
+	/** Weapon world traces sent to the async trace queue, they run off the game thread so are counted but not timed */
+	static int32 NumAsyncWeaponTraces;
+
+	/** Time spent in and number of weapon traces against the character hitboxes */
+	static double HitboxTraceSeconds;
+	static int32 NumHitboxTraces;
+
+private:
+
+	void SpawnBot();
+
+	/** Bots that died are detached from their pawn, give them a new one */
+	void RespawnBots();
+
+	FString WriteReport() const;
+
+	UPROPERTY()
+	TArray<ASBotController*> Bots;
+
+	/** Milliseconds for every frame recorded */
+	TArray<float> FrameTimes;
+	TArray<float> GameThreadTimes;
+
+	int32 NumBots;
+	float Duration;
+	float ElapsedTime;
+	float TimeSinceRespawnCheck;
+
+	double StartWeaponTraceSeconds;
+	int32 StartNumWeaponTraces;
+	int32 StartNumAsyncWeaponTraces;
+	double StartHitboxTraceSeconds;
+	int32 StartNumHitboxTraces;
+
+	uint64 StartUsedMemory;
+	uint64 PeakUsedMemory;
+
+	/** Set from the command line, the test starts once the world has begun play */
+	int32 CommandLineBots;
+	float CommandLineDuration;
+	bool bExitWhenDone;
+
+	bool bRunning;
+	bool bInitialized = false;
+};
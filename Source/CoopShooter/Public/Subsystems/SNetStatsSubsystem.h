@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SNetStatsSubsystem.generated.h"
+
+/**
+ * Samples per player bandwidth on the server, checks it against the budget and writes the net stats to a CSV when the match ends.
+ */
+UCLASS()
+class COOPSHOOTER_API USNetStatsSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Write the stats recorded so far, returns the file written or an empty string on failure */
+	FString WriteCSV() const;
+
+	/** Forget the peak and over budget samples so far, e.g. to leave out the bandwidth burst of players joining */
+	void ResetSamples();
+
+	/** The highest bytes per second any single player has been sent this match */
+	int32 GetPeakPlayerBytesPerSecond() const { return PeakPlayerBytesPerSecond; }
+
+	/** How many samples have had a player over the budget this match */
+	int32 GetNumOverBudgetSamples() const { return NumOverBudgetSamples; }
+
+	static int32 GetBudgetBytesPerPlayer();
+
+private:
+
+	void SampleConnections();
+
+	float TimeSinceLastSample;
+
+	int32 PeakPlayerBytesPerSecond;
+	int32 NumOverBudgetSamples;
+
+	bool bInitialized = false;
+};
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SParticlePoolSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+class USceneComponent;
+
+/* Every component created for a single particle system template */
+USTRUCT()
+struct FSParticlePool
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Components;
+
+	/** The world time each component was last handed out, matches Components by index */
+	TArray<float> LastUsedTimes;
+};
+
+/**
+ * Hands out recycled particle system components instead of spawning a new one for every effect.
+ * Each template gets its own pool, once a pool is full the least recently used component is stolen.
+ */
+UCLASS()
+class COOPSHOOTER_API USParticlePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/** Create components for a template ahead of time so the first shots do not allocate */
+	void Preallocate(UParticleSystem* Template, int32 Count);
+
+	/** Play an effect at a world location */
+	UParticleSystemComponent* SpawnEmitterAtLocation(UParticleSystem* Template, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	/** Play an effect attached to a component */
+	UParticleSystemComponent* SpawnEmitterAttached(UParticleSystem* Template, USceneComponent* AttachToComponent, FName AttachPointName = NAME_None);
+
+private:
+
+	/** Find a free component for the template, creating or stealing one if needed */
+	UParticleSystemComponent* AcquireComponent(UParticleSystem* Template);
+
+	UParticleSystemComponent* CreateComponent(UParticleSystem* Template);
+
+	/** Effects are never played on a dedicated server and the pool can be turned off */
+	bool CanUsePool() const;
+
+	UPROPERTY()
+	TMap<UParticleSystem*, FSParticlePool> Pools;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SPickupSubsystem.generated.h"
+
+class ASWeaponPickup;
+class ASCharacter;
+
+/**
+ * Every pickup on the server in a uniform grid on the ground plane, rebuilt at most once a frame.
+ * Each cell links its pickups through NextInCell, so building and querying the grid never allocates once it has warmed up.
+ */
+struct FSPickupGrid
+{
+	/** The first pickup in each occupied cell */
+	TMap<FIntPoint, int32> CellHeads;
+
+	/** Per pickup, the next pickup in the same cell or INDEX_NONE */
+	TArray<int32> NextInCell;
+	TArray<FVector> Locations;
+
+	float CellSize = 1.0f;
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	void Reset();
+};
+
+/**
+ * Looks after the weapon pickups on the server instead of each pickup ticking and overlapping on its own.
+ * Once a frame every living character is checked against the pickups in the grid cells around it, and pickups
+ * past their lifetime, or the oldest ones past the cap, are despawned.
+ */
+UCLASS()
+class COOPSHOOTER_API USPickupSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterPickup(ASWeaponPickup* Pickup);
+	void UnregisterPickup(ASWeaponPickup* Pickup);
+
+	int32 GetNumPickups() const { return Pickups.Num(); }
+
+private:
+
+	/** The closest pickup within the pickup radius of a location, or INDEX_NONE. Only valid right after the grid is built */
+	int32 FindClosestPickup(const FVector& Location) const;
+
+	/** Destroy pickups past their lifetime and the oldest past the cap */
+	void DespawnPickups();
+
+	void UpdateGrid();
+
+	/** Hand pickups to every living character standing on one */
+	void ResolvePickups();
+
+	/** Oldest first, SpawnTimes matches by index */
+	UPROPERTY()
+	TArray<ASWeaponPickup*> Pickups;
+
+	TArray<float> SpawnTimes;
+
+	FSPickupGrid Grid;
+
+	/** Pickups taken or despawned this frame, destroyed once the frame's pass is done */
+	TArray<ASWeaponPickup*> PickupsToDestroy;
+};
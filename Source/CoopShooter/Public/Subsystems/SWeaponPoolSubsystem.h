@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SWeaponPoolSubsystem.generated.h"
+
+class ASWeapon;
+
+/**
+ * Keeps weapon actors that are not in anyones hands around on the server, so swapping weapons or respawning
+ * takes one out again instead of spawning a new actor with its skeletal mesh.
+ * Pooled weapons are hidden, unowned and no longer depend on a character, so they are not replicated.
+ */
+UCLASS()
+class COOPSHOOTER_API USWeaponPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/** Take a weapon of the class out of the pool, spawning one if there is none */
+	ASWeapon* AcquireWeapon(TSubclassOf<ASWeapon> WeaponClass, AActor* NewOwner);
+
+	/** Put a weapon back in the pool, it is destroyed if the pool is full */
+	void ReleaseWeapon(ASWeapon* Weapon);
+
+private:
+
+	UPROPERTY()
+	TArray<ASWeapon*> PooledWeapons;
+};
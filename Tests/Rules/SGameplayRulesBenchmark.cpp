@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Rules/SGameplayRules.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/** Keeps the compiler from dropping the work being timed */
+static volatile float Sink = 0.0f;
+
+/** Run Body over every input and print the time per call */
+template<typename FunctionType>
+static void Benchmark(const char* Name, int NumIterations, FunctionType Body)
+{
+	const auto Start = std::chrono::steady_clock::now();
+
+	float Sum = 0.0f;
+	for (int i = 0; i < NumIterations; i++)
+	{
+		Sum += Body(i);
+	}
+
+	const auto End = std::chrono::steady_clock::now();
+	Sink = Sum;
+
+	const double Nanoseconds = std::chrono::duration<double, std::nano>(End - Start).count();
+	std::printf("%-24s %8.3f ns/call\n", Name, Nanoseconds / NumIterations);
+}
+
+int main(int argc, char** argv)
+{
+	const int NumIterations = argc > 1 ? std::atoi(argv[1]) : 10000000;
+	if (NumIterations <= 0)
+		return 1;
+
+	// Inputs are read from memory so the calls can not be folded away
+	const int NumInputs = 4096;
+	std::vector<float> Inputs(NumInputs);
+	for (int i = 0; i < NumInputs; i++)
+	{
+		Inputs[i] = static_cast<float>(std::rand() % 2000) * 0.1f;
+	}
+
+	const int Mask = NumInputs - 1;
+
+	Benchmark("GetTimeBetweenShots", NumIterations, [&](int i) { return SGameplayRules::GetTimeBetweenShots(Inputs[i & Mask] * 10.0f); });
+	Benchmark("GetFirstShotTime", NumIterations, [&](int i) { return SGameplayRules::GetFirstShotTime(Inputs[i & Mask], 0.1f, Inputs[(i + 1) & Mask]); });
+	Benchmark("GetHitDamage", NumIterations, [&](int i) { return SGameplayRules::GetHitDamage(Inputs[i & Mask], 80.0f, (i & 3) == 0); });
+	Benchmark("ApplyDamage", NumIterations, [&](int i) { return SGameplayRules::ApplyDamage(100.0f, Inputs[i & Mask], 100.0f); });
+	Benchmark("GiveHealth", NumIterations, [&](int i) { return SGameplayRules::GiveHealth(Inputs[i & Mask], 20.0f, 100.0f); });
+	Benchmark("GetRegeneratedHealth", NumIterations, [&](int i) { return SGameplayRules::GetRegeneratedHealth(40.0f, 10.0f, 20.0f, 100.0f, Inputs[i & Mask]); });
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Rules/SGameplayRules.h"
+
+#include <cmath>
+#include <cstdio>
+
+static int NumFailures = 0;
+
+static void CheckNear(const char* Name, float Actual, float Expected, float Tolerance = 1e-4f)
+{
+	if (std::fabs(Actual - Expected) > Tolerance)
+	{
+		std::printf("FAIL %s: expected %f, got %f\n", Name, Expected, Actual);
+		NumFailures++;
+	}
+}
+
+static void TestTimeBetweenShots()
+{
+	CheckNear("TimeBetweenShots 600rpm", SGameplayRules::GetTimeBetweenShots(600.0f), 0.1f);
+	CheckNear("TimeBetweenShots 60rpm", SGameplayRules::GetTimeBetweenShots(60.0f), 1.0f);
+
+	// Zero means the weapon can not fire, the fire scheduler relies on it never being tiny
+	CheckNear("TimeBetweenShots 0rpm", SGameplayRules::GetTimeBetweenShots(0.0f), 0.0f, 0.0f);
+	CheckNear("TimeBetweenShots negative", SGameplayRules::GetTimeBetweenShots(-100.0f), 0.0f, 0.0f);
+}
+
+static void TestFirstShotTime()
+{
+	// Long since the last shot, fire right away
+	CheckNear("FirstShotTime idle", SGameplayRules::GetFirstShotTime(1.0f, 0.1f, 5.0f), 5.0f);
+
+	// Tapping fire waits out the rate of fire
+	CheckNear("FirstShotTime tap", SGameplayRules::GetFirstShotTime(5.0f, 0.1f, 5.05f), 5.1f);
+
+	// A weapon that has never fired
+	CheckNear("FirstShotTime never fired", SGameplayRules::GetFirstShotTime(-1e30f, 0.1f, 2.0f), 2.0f);
+}
+
+static void TestHitDamage()
+{
+	CheckNear("HitDamage base", SGameplayRules::GetHitDamage(20.0f, 80.0f, false), 20.0f);
+	CheckNear("HitDamage vulnerable", SGameplayRules::GetHitDamage(20.0f, 80.0f, true), 80.0f);
+}
+
+static void TestApplyDamage()
+{
+	CheckNear("ApplyDamage hit", SGameplayRules::ApplyDamage(100.0f, 30.0f, 100.0f), 70.0f);
+	CheckNear("ApplyDamage overkill", SGameplayRules::ApplyDamage(10.0f, 30.0f, 100.0f), 0.0f);
+
+	// Negative damage heals, but never past the maximum
+	CheckNear("ApplyDamage negative", SGameplayRules::ApplyDamage(90.0f, -30.0f, 100.0f), 100.0f);
+}
+
+static void TestGiveHealth()
+{
+	CheckNear("GiveHealth heal", SGameplayRules::GiveHealth(50.0f, 20.0f, 100.0f), 70.0f);
+	CheckNear("GiveHealth capped", SGameplayRules::GiveHealth(90.0f, 20.0f, 100.0f), 100.0f);
+	CheckNear("GiveHealth dead", SGameplayRules::GiveHealth(0.0f, 20.0f, 100.0f), 0.0f);
+	CheckNear("GiveHealth nothing", SGameplayRules::GiveHealth(50.0f, -20.0f, 100.0f), 50.0f);
+
+	// Health already above the maximum is not taken away by a heal
+	CheckNear("GiveHealth overhealed", SGameplayRules::GiveHealth(120.0f, 20.0f, 100.0f), 120.0f);
+}
+
+static void TestRegeneratedHealth()
+{
+	CheckNear("Regen before start", SGameplayRules::GetRegeneratedHealth(40.0f, 10.0f, 20.0f, 100.0f, 9.0f), 40.0f);
+	CheckNear("Regen at start", SGameplayRules::GetRegeneratedHealth(40.0f, 10.0f, 20.0f, 100.0f, 10.0f), 40.0f);
+	CheckNear("Regen running", SGameplayRules::GetRegeneratedHealth(40.0f, 10.0f, 20.0f, 100.0f, 11.5f), 70.0f);
+	CheckNear("Regen capped", SGameplayRules::GetRegeneratedHealth(40.0f, 10.0f, 20.0f, 100.0f, 60.0f), 100.0f);
+	CheckNear("Regen dead", SGameplayRules::GetRegeneratedHealth(0.0f, 10.0f, 20.0f, 100.0f, 60.0f), 0.0f);
+	CheckNear("Regen no rate", SGameplayRules::GetRegeneratedHealth(40.0f, 10.0f, 0.0f, 100.0f, 60.0f), 40.0f);
+	CheckNear("Regen overhealed", SGameplayRules::GetRegeneratedHealth(120.0f, 10.0f, 20.0f, 100.0f, 60.0f), 120.0f);
+}
+
+int main()
+{
+	TestTimeBetweenShots();
+	TestFirstShotTime();
+	TestHitDamage();
+	TestApplyDamage();
+	TestGiveHealth();
+	TestRegeneratedHealth();
+
+	if (NumFailures > 0)
+	{
+		std::printf("%d checks failed\n", NumFailures);
+		return 1;
+	}
+
+	std::printf("All gameplay rules checks passed\n");
+	return 0;
+}